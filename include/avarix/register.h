@@ -18,6 +18,10 @@
  */
 static inline void ccp_io_write(volatile uint8_t* addr, uint8_t value)
 {
+#ifdef HOST_VERSION
+  CCP = CCP_IOREG_gc;
+  *addr = value;
+#else
   asm volatile (
       "out  %[ccp], %[ccp_ioreg]\n"
       "st   Z, %[val]\n"
@@ -27,6 +31,7 @@ static inline void ccp_io_write(volatile uint8_t* addr, uint8_t value)
       ,             "z" ((uint16_t)addr)
       , [val]       "r" (value)
       );
+#endif
 }
 
 
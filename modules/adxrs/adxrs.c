@@ -9,6 +9,7 @@
 #include <util/parity.h>
 #include <clock/defs.h>
 #include <util/delay.h>
+#include <avarix/internal.h>
 #include "adxrs.h"
 #include "adxrs_config.h"
 
@@ -63,8 +64,93 @@
 #endif
 
 
+#ifdef ADXRS_DMA_TC
+
+# define ADXRS_DMA_CH_RX  AVARIX_EVALCONCAT2(DMA.CH, ADXRS_DMA_RX_CH)
+# define ADXRS_DMA_CH_TX  AVARIX_EVALCONCAT2(DMA.CH, ADXRS_DMA_TX_CH)
+# define ADXRS_DMA_CH_START  AVARIX_EVALCONCAT2(DMA.CH, ADXRS_DMA_START_CH)
+# define ADXRS_DMA_CH_RX_vect  AVARIX_EVALCONCAT3(DMA_CH, ADXRS_DMA_RX_CH, _vect)
+# define ADXRS_DMA_TRIGSRC_SPI  AVARIX_EVALCONCAT3(DMA_CH_TRIGSRC_, ADXRS_SPI, _gc)
+# define ADXRS_DMA_TRIGSRC_TC  AVARIX_EVALCONCAT3(DMA_CH_TRIGSRC_, ADXRS_DMA_TC, _OVF_gc)
+
+# if ADXRS_DMA_RX_CH == ADXRS_DMA_TX_CH || ADXRS_DMA_RX_CH == ADXRS_DMA_START_CH \
+    || ADXRS_DMA_TX_CH == ADXRS_DMA_START_CH
+#  error ADXRS DMA channels must be different
+# endif
+
+# if ADXRS_DMA_PRESCALER_DIV == 1
+#  define ADXRS_DMA_TC_CLKSEL  1
+# elif ADXRS_DMA_PRESCALER_DIV == 2
+#  define ADXRS_DMA_TC_CLKSEL  2
+# elif ADXRS_DMA_PRESCALER_DIV == 4
+#  define ADXRS_DMA_TC_CLKSEL  3
+# elif ADXRS_DMA_PRESCALER_DIV == 8
+#  define ADXRS_DMA_TC_CLKSEL  4
+# elif ADXRS_DMA_PRESCALER_DIV == 64
+#  define ADXRS_DMA_TC_CLKSEL  5
+# elif ADXRS_DMA_PRESCALER_DIV == 256
+#  define ADXRS_DMA_TC_CLKSEL  6
+# elif ADXRS_DMA_PRESCALER_DIV == 1024
+#  define ADXRS_DMA_TC_CLKSEL  7
+# else
+#  error Invalid ADXRS_DMA_PRESCALER_DIV value
+# endif
+
+#endif
+
+
+#ifdef ADXRS_TIMESTAMP_TIMER
+
+# define ADXRS_TIMESTAMP_TC  AVARIX_EVALCONCAT2(TC, ADXRS_TIMESTAMP_TIMER)
+# define ADXRS_TIMESTAMP_CC  AVARIX_EVALCONCAT2(ADXRS_TIMESTAMP_TC.CC, ADXRS_TIMESTAMP_CH)
+# define ADXRS_TIMESTAMP_CCIF_bm  AVARIX_EVALCONCAT3(TC0_CC, ADXRS_TIMESTAMP_CH, IF_bm)
+
+# ifndef ADXRS_SAMPLES_LENGTH
+#  define ADXRS_SAMPLES_LENGTH  16
+# endif
+# if ADXRS_TIMESTAMP_PRESCALER_DIV != 1 && ADXRS_TIMESTAMP_PRESCALER_DIV != 2 \
+    && ADXRS_TIMESTAMP_PRESCALER_DIV != 4 && ADXRS_TIMESTAMP_PRESCALER_DIV != 8 \
+    && ADXRS_TIMESTAMP_PRESCALER_DIV != 64 && ADXRS_TIMESTAMP_PRESCALER_DIV != 256 \
+    && ADXRS_TIMESTAMP_PRESCALER_DIV != 1024
+#  error Invalid ADXRS_TIMESTAMP_PRESCALER_DIV value
+# endif
+
+# if ADXRS_SAMPLES_LENGTH < 1 || ADXRS_SAMPLES_LENGTH > 255
+#  error Invalid ADXRS_SAMPLES_LENGTH value
+# endif
+
+# if defined(ADXRS_DMA_TC) && ADXRS_DMA_PRESCALER_DIV % ADXRS_TIMESTAMP_PRESCALER_DIV != 0
+#  error ADXRS_DMA_PRESCALER_DIV must be a multiple of ADXRS_TIMESTAMP_PRESCALER_DIV
+# endif
+
+/// Update and return the time of a capture
+# define ADXRS_CAPTURE_TIME()  adxrs_update_capture_time()
+
+#else
+
+# define ADXRS_CAPTURE_TIME()  0
+
+#endif
+
+
 #define CALIBRATION_SAMPLES_LENGTH 101
 
+/** @brief Number of fractional bits of fixed-point angle and scale
+ *
+ * Scales converting gyro values to milliradians fit on 32 bits, angle range
+ * is about +/-8e6 (8000 radians, in milliradians).
+ */
+#define ANGLE_FRAC_BITS  40
+
+#ifdef ADXRS_TIMESTAMP_TIMER
+/** @brief Number of significant bits of the scale per tick
+ *
+ * Integrated rates are lower than 2^32, their product with the scale must
+ * not overflow 63 bits.
+ */
+# define TICK_SCALE_BITS  24
+#endif
+
 /** @brief ADXRS gyro data
  *
  * The \e response field contains data of the last received response, i.e. the
@@ -74,20 +160,40 @@
 typedef struct {
   portpin_t cspp;  ///< port pin of the inversed CS pin
   adxrs_response_t response;  ///< response to the penultimate command
-  float angle;  ///< current angle for capture mode
-  float capture_scale;  ///< scaling coefficient for captured values
+  int64_t angle;  ///< current angle for capture mode, fixed-point
+  int32_t capture_scale;  ///< scaling coefficient for captured values, fixed-point
+#ifdef ADXRS_TIMESTAMP_TIMER
+  uint8_t capture_shift;  ///< right shift applied after scaling, per tick scale only
+#endif
   uint8_t capture_index;  ///< index of next captured byte
   int16_t capture_speed;  ///< last (valid) captured angle speed
 
   bool integrate; ///< if true adxrs module will integrate position over time
 
+#ifdef ADXRS_TIMESTAMP_TIMER
+  uint16_t capture_cnt;  ///< TC counter value at last capture
+  uint32_t capture_time;  ///< time of last capture, in ticks
+  bool sample_valid;  ///< true if last sample can be used for integration
+  uint8_t samples_head;  ///< index of last sample
+  uint8_t samples_count;  ///< number of samples in buffer
+  adxrs_sample_t samples[ADXRS_SAMPLES_LENGTH];  ///< last timestamped samples
+#endif
+
+#ifdef ADXRS_DMA_TC
+  uint8_t dma_buffers[2][4];  ///< DMA capture buffers
+  uint8_t dma_index;  ///< index of the buffer being filled by DMA
+# ifdef ADXRS_TIMESTAMP_TIMER
+  uint32_t dma_period;  ///< DMA capture period, in timestamp ticks
+  uint32_t dma_time;  ///< time of the last DMA capture, in timestamp ticks
+# endif
+#endif
+
   struct {
     bool mode;  ///< calibration mode
-    int16_t offset;  ///< calibration offset
-    float offset_sqsd; ///< calibration squared sd
+    int16_t offset;  ///< calibration offset, updated when calibration ends
 
-    float sum;
-    float sqsum;
+    int32_t sum;  ///< sum of samples
+    uint64_t sqsum;  ///< sum of squared samples
     fifo_t samples;
     int16_t samples_buffer[CALIBRATION_SAMPLES_LENGTH];
   } calibration;
@@ -105,7 +211,8 @@ void adxrs_init(portpin_t cspp)
   gyro.angle = 0;
   gyro.calibration.mode = false;
   gyro.calibration.offset = 0;
-  gyro.calibration.offset_sqsd = +INFINITY;
+  gyro.calibration.sum = 0;
+  gyro.calibration.sqsum = 0;
 
   gyro.integrate = true;
 
@@ -288,12 +395,99 @@ bool adxrs_startup(void)
 }
 
 
-void adxrs_capture_start(float scale)
+/** @brief Saturate a float value
+ *
+ * Infinite values are saturated too, NaN is replaced by 0.
+ */
+static float adxrs_saturate(float value, float max)
 {
+  if(isnan(value)) {
+    return 0;
+  } else if(!(fabsf(value) < max)) {
+    return copysignf(max, value);
+  }
+  return value;
+}
+
+/** @brief Convert a float scale to fixed-point, set it as capture scale
+ *
+ * With timestamps, the scale is given per second and converted to a scale
+ * per tick. Since it is very small, it is stored as a \ref TICK_SCALE_BITS
+ * mantissa and a right shift instead of using \ref ANGLE_FRAC_BITS.
+ *
+ * Scales out of the fixed-point range are saturated.
+ */
+static void adxrs_set_capture_scale(float scale)
+{
+#ifdef ADXRS_TIMESTAMP_TIMER
+  // the halving of the trapezoidal rule is included
+  // saturate to the largest mantissa, without shift
+  scale = adxrs_saturate(scale * ((float)ADXRS_TIMESTAMP_PRESCALER_DIV / CLOCK_PER_FREQ / 2),
+                         ldexpf((1L << TICK_SCALE_BITS) - 1, -ANGLE_FRAC_BITS));
+  int exp;
+  float mantissa = frexpf(scale, &exp);
+  int shift = TICK_SCALE_BITS - ANGLE_FRAC_BITS - exp;
+  if(shift > 63) {
+    // negligible scale
+    mantissa = 0;
+  }
+  gyro.capture_scale = lroundf(ldexpf(mantissa, TICK_SCALE_BITS));
+  gyro.capture_shift = mantissa == 0 ? 0 : shift;
+#else
+  // largest float lower than 2^31
+  gyro.capture_scale = lroundf(adxrs_saturate(ldexpf(scale, ANGLE_FRAC_BITS), 2147483520.0f));
+#endif
+}
+
+#ifdef ADXRS_TIMESTAMP_TIMER
+/** @brief Set the counter value of the last update, reset wrap detection
+ *
+ * The compare flag is set when the counter reaches this value again, i.e.
+ * 0x10000 ticks later.
+ */
+static void adxrs_set_capture_cnt(uint16_t cnt)
+{
+  gyro.capture_cnt = cnt;
+  ADXRS_TIMESTAMP_CC = cnt;
+  ADXRS_TIMESTAMP_TC.INTFLAGS = ADXRS_TIMESTAMP_CCIF_bm;
+}
+
+/** @brief Update and return capture time from TC counter
+ *
+ * If the counter wrapped since the last update, elapsed time is unknown:
+ * capture time misses whole wraps and the last sample is invalidated.
+ *
+ * @note Must be called with interrupts disabled or from the capture handler.
+ */
+static uint32_t adxrs_update_capture_time(void)
+{
+  uint16_t cnt = ADXRS_TIMESTAMP_TC.CNT;
+  // flag is read after the counter: a match in between is a false positive
+  if(ADXRS_TIMESTAMP_TC.INTFLAGS & ADXRS_TIMESTAMP_CCIF_bm) {
+    gyro.sample_valid = false;
+  }
+  gyro.capture_time += (uint16_t)(cnt - gyro.capture_cnt);
+  adxrs_set_capture_cnt(cnt);
+  return gyro.capture_time;
+}
+#endif
+
+/// Reset capture state and send the first sensor data command
+static void adxrs_capture_init(float scale)
+{
+  adxrs_set_capture_scale(scale);
   gyro.angle = 0;
-  gyro.capture_scale = scale;
   gyro.capture_index = 0;
   gyro.capture_speed = 0;
+#ifdef ADXRS_TIMESTAMP_TIMER
+  INTLVL_DISABLE_ALL_BLOCK() {
+    adxrs_set_capture_cnt(ADXRS_TIMESTAMP_TC.CNT);
+    gyro.capture_time = 0;
+    gyro.sample_valid = false;
+    gyro.samples_head = 0;
+    gyro.samples_count = 0;
+  }
+#endif
 
   // Send a sensor data command to be sure that the first response received by
   // the interrupt handler is a sensor data response with an up-to-date value.
@@ -303,6 +497,11 @@ void adxrs_capture_start(float scale)
   adxrs_spi_transmit(0x00);
   adxrs_spi_transmit(0x00);
   portpin_outset(&gyro.cspp);
+}
+
+void adxrs_capture_start(float scale)
+{
+  adxrs_capture_init(scale);
 
   // Enable interruptions and start the capture with the first command byte
   ADXRS_SPI.INTCTRL = ADXRS_CAPTURE_INTLVL;
@@ -313,16 +512,123 @@ void adxrs_capture_start(float scale)
   ADXRS_SPI.DATA = 0x20;
 }
 
+#ifdef ADXRS_DMA_TC
+
+/// Command bytes sent by DMA, must be in data memory
+static const uint8_t adxrs_dma_cmd[2] = { 0x20, 0x00 };
+
+/// Set a 24-bit DMA address register
+static void adxrs_dma_set_address(register8_t *reg, const volatile void *p)
+{
+  uint16_t addr = (uintptr_t)p;
+  reg[0] = addr & 0xff;
+  reg[1] = addr >> 8;
+  reg[2] = 0;
+}
+
+/** @brief Prepare DMA channels for the next capture
+ *
+ * The RX channel receives the 4 response bytes in the next buffer, the TX
+ * channel sends the 3 last command bytes. Both are triggered by SPI transfer
+ * completion and are disabled once done, until the next call.
+ * Transfer completion and errors of the RX channel trigger an interrupt.
+ */
+static void adxrs_dma_arm(void)
+{
+  adxrs_dma_set_address(&ADXRS_DMA_CH_RX.DESTADDR0, gyro.dma_buffers[gyro.dma_index]);
+  ADXRS_DMA_CH_RX.TRFCNT = 4;
+  ADXRS_DMA_CH_RX.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm |
+      (ADXRS_CAPTURE_INTLVL << DMA_CH_ERRINTLVL_gp) |
+      (ADXRS_CAPTURE_INTLVL << DMA_CH_TRNINTLVL_gp);
+  ADXRS_DMA_CH_RX.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+
+  ADXRS_DMA_CH_TX.TRFCNT = 3;
+  ADXRS_DMA_CH_TX.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+}
+
+void adxrs_capture_start_dma(float scale, uint16_t period)
+{
+  adxrs_capture_init(scale);
+  ADXRS_SPI.INTCTRL = 0;
+  DMA.CTRL |= DMA_ENABLE_bm;
+
+  // start channel: send the first command byte on each TC overflow, forever
+  ADXRS_DMA_CH_START.CTRLA = 0;
+  ADXRS_DMA_CH_START.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+      DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+  ADXRS_DMA_CH_START.TRIGSRC = ADXRS_DMA_TRIGSRC_TC;
+  ADXRS_DMA_CH_START.TRFCNT = 1;
+  ADXRS_DMA_CH_START.REPCNT = 0;
+  adxrs_dma_set_address(&ADXRS_DMA_CH_START.SRCADDR0, &adxrs_dma_cmd[0]);
+  adxrs_dma_set_address(&ADXRS_DMA_CH_START.DESTADDR0, &ADXRS_SPI.DATA);
+  ADXRS_DMA_CH_START.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_REPEAT_bm |
+      DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+
+  // TX channel: send null command bytes
+  ADXRS_DMA_CH_TX.CTRLA = 0;
+  ADXRS_DMA_CH_TX.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+      DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+  ADXRS_DMA_CH_TX.TRIGSRC = ADXRS_DMA_TRIGSRC_SPI;
+  adxrs_dma_set_address(&ADXRS_DMA_CH_TX.SRCADDR0, &adxrs_dma_cmd[1]);
+  adxrs_dma_set_address(&ADXRS_DMA_CH_TX.DESTADDR0, &ADXRS_SPI.DATA);
+
+  // RX channel: receive response bytes
+  ADXRS_DMA_CH_RX.CTRLA = 0;
+  ADXRS_DMA_CH_RX.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+      DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_INC_gc;
+  ADXRS_DMA_CH_RX.TRIGSRC = ADXRS_DMA_TRIGSRC_SPI;
+  adxrs_dma_set_address(&ADXRS_DMA_CH_RX.SRCADDR0, &ADXRS_SPI.DATA);
+
+  gyro.dma_index = 0;
+#ifdef ADXRS_TIMESTAMP_TIMER
+  gyro.dma_period = (uint32_t)period * (ADXRS_DMA_PRESCALER_DIV / ADXRS_TIMESTAMP_PRESCALER_DIV);
+  gyro.dma_time = 0;
+#endif
+  adxrs_dma_arm();
+  portpin_outclr(&gyro.cspp);
+
+  // start the TC, first capture is triggered after a period
+  ADXRS_DMA_TC.CTRLA = 0;
+  ADXRS_DMA_TC.CNT = 0;
+  ADXRS_DMA_TC.PER = period - 1;
+  ADXRS_DMA_TC.CTRLA = ADXRS_DMA_TC_CLKSEL;
+}
+
+#endif
+
 void adxrs_capture_stop(void)
 {
   ADXRS_SPI.INTCTRL = 0;
+#ifdef ADXRS_DMA_TC
+  ADXRS_DMA_TC.CTRLA = 0;
+  ADXRS_DMA_CH_START.CTRLA = 0;
+  ADXRS_DMA_CH_TX.CTRLA = 0;
+  ADXRS_DMA_CH_RX.CTRLA = 0;
+#endif
   gyro.response.type = ADXRS_RESPONSE_NONE;
   portpin_outset(&gyro.cspp);
 }
 
+/** @brief Compute offset from calibration samples
+ * @note Must be called with interrupts disabled.
+ */
+static int16_t adxrs_calibration_offset(void)
+{
+  uint16_t n = fifo_size(&gyro.calibration.samples);
+  if(n == 0) {
+    return gyro.calibration.offset;
+  }
+  return gyro.calibration.sum / n;
+}
+
 void adxrs_calibration_mode(bool activate)
 {
-  gyro.calibration.mode = activate;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(gyro.calibration.mode && !activate) {
+      gyro.calibration.offset = adxrs_calibration_offset();
+    }
+    gyro.calibration.mode = activate;
+  }
 }
 
 void adxrs_integrate(bool activate)
@@ -337,17 +643,22 @@ bool adxrs_get_calibration_mode()
 
 float adxrs_get_angle(void)
 {
-  float angle;
+  int64_t angle;
   INTLVL_DISABLE_ALL_BLOCK() {
     angle = gyro.angle;
   }
-  return angle;
+  return ldexpf(angle, -ANGLE_FRAC_BITS);
 }
 
 void adxrs_set_angle(float angle)
 {
+  if(isnan(angle)) {
+    return;
+  }
+  // saturate to half the fixed-point range, integration can still go on
+  int64_t value = adxrs_saturate(ldexpf(angle, ANGLE_FRAC_BITS), ldexpf(1, 62));
   INTLVL_DISABLE_ALL_BLOCK() {
-    gyro.angle = angle;
+    gyro.angle = value;
   }
 }
 
@@ -362,21 +673,99 @@ float adxrs_get_speed(void) {
 int16_t adxrs_get_offset() {
   int16_t offset;
   INTLVL_DISABLE_ALL_BLOCK() {
-    offset = gyro.calibration.offset;
+    offset = gyro.calibration.mode ? adxrs_calibration_offset() : gyro.calibration.offset;
   }
   return offset;
 }
 
 float adxrs_get_offset_sqsd() {
-  float sqsd;
+  uint16_t n;
+  int32_t sum;
+  uint64_t sqsum;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    n = fifo_size(&gyro.calibration.samples);
+    sum = gyro.calibration.sum;
+    sqsum = gyro.calibration.sqsum;
+  }
+  if(n == 0) {
+    return +INFINITY;
+  }
+
+  // compute mean value and mean of squared values
+  float mean = (float)sum/n;
+  float sqmean = (float)sqsum/n;
+
+  // compute squared standard dev of measure
+  return 1.0*(n*sqmean - mean*mean)/(n*n);
+}
+
+#ifdef ADXRS_TIMESTAMP_TIMER
+
+uint32_t adxrs_get_capture_time(void)
+{
+  uint32_t time;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    time = adxrs_update_capture_time();
+  }
+  return time;
+}
+
+uint8_t adxrs_get_samples(adxrs_sample_t *samples, uint8_t n)
+{
   INTLVL_DISABLE_ALL_BLOCK() {
-    sqsd = gyro.calibration.offset_sqsd;
+    if(n > gyro.samples_count) {
+      n = gyro.samples_count;
+    }
+    uint8_t index = gyro.samples_head;
+    for(uint8_t i=0; i<n; i++) {
+      samples[i] = gyro.samples[index];
+      index = (index == 0 ? ADXRS_SAMPLES_LENGTH : index) - 1;
+    }
   }
-  return sqsd;
+  return n;
 }
 
-// Update captured angle value
-static void adxrs_update_angle(uint8_t data[4])
+/** @brief Integrate a new sample, using trapezoidal rule
+ *
+ * Integration is skipped if there is no previous valid sample or if it is
+ * 0x10000 ticks or more old (for instance, after invalid responses).
+ */
+static void adxrs_integrate_sample(uint32_t time, int16_t speed)
+{
+  const adxrs_sample_t *prev = &gyro.samples[gyro.samples_head];
+  int32_t dt = time - prev->time;
+  if(gyro.sample_valid && gyro.integrate && dt < 0x10000) {
+    // (prev + speed) * dt / 2, dt is lower than 0x10000 so delta is lower
+    // than 2^32, halving is included in the scale
+    int64_t delta = (int64_t)((int32_t)prev->rate + speed) * dt;
+    int64_t angle = gyro.angle + ((delta * gyro.capture_scale) >> gyro.capture_shift);
+    INTLVL_DISABLE_ALL_BLOCK() {
+      gyro.angle = angle;
+    }
+  }
+
+  // store the new sample
+  uint8_t head = gyro.samples_head + 1;
+  if(head == ADXRS_SAMPLES_LENGTH) {
+    head = 0;
+  }
+  gyro.samples[head].time = time;
+  gyro.samples[head].rate = speed;
+  gyro.samples_head = head;
+  if(gyro.samples_count < ADXRS_SAMPLES_LENGTH) {
+    gyro.samples_count++;
+  }
+  gyro.sample_valid = true;
+}
+
+#endif
+
+/** @brief Update captured angle value
+ *
+ * @param data  response data
+ * @param time  capture time, unused without timestamps
+ */
+static void adxrs_update_angle(uint8_t data[4], uint32_t time)
 {
   if(adxrs_check_response_parity(data) && (data[0] & 0x0C) == 0x04) {
     // valid response, parse speed
@@ -386,44 +775,31 @@ static void adxrs_update_angle(uint8_t data[4])
   else
     return;
 
-  // check calibration signal rising edge
-  static bool lcalibration = false;
-  if(gyro.calibration.mode && !lcalibration) {
-    gyro.calibration.offset = gyro.capture_speed;
-  }
-  lcalibration = gyro.calibration.mode;
-
   if(gyro.calibration.mode) {
-
-    // update sum
-    float v = gyro.capture_speed;
+#ifdef ADXRS_TIMESTAMP_TIMER
+    // raw samples cannot be integrated with corrected ones
+    gyro.sample_valid = false;
+#endif
+    // update sums, offset and deviation are computed when retrieved
+    int16_t v = gyro.capture_speed;
     if(fifo_isfull(&gyro.calibration.samples)) {
-      float ov = fifo_pop(&gyro.calibration.samples);
+      int16_t ov = fifo_pop(&gyro.calibration.samples);
       gyro.calibration.sum -= ov;
-      gyro.calibration.sqsum -= ov*ov;
+      gyro.calibration.sqsum -= (int32_t)ov*ov;
     }
     gyro.calibration.sum += v;
-    gyro.calibration.sqsum += v*v;
+    gyro.calibration.sqsum += (int32_t)v*v;
     fifo_push(&gyro.calibration.samples, v);
-
-    // compute mean value and mean of squared values
-    int n = fifo_size(&gyro.calibration.samples);
-    float mean = gyro.calibration.sum/n;
-    float sqmean = gyro.calibration.sqsum/n;
-
-    // compute squared standard dev of measure
-    float sqsd = 1.0*(n*sqmean - mean*mean)/(n*n);
-
-    // update gyro offset
-    gyro.calibration.offset = mean;
-    gyro.calibration.offset_sqsd = sqsd;
   }
   else {
     // update angle (internal) value
     // on error, previous (valid) speed value is used
     gyro.capture_speed = gyro.capture_speed - gyro.calibration.offset;
+#ifdef ADXRS_TIMESTAMP_TIMER
+    adxrs_integrate_sample(time, gyro.capture_speed);
+#else
     if(gyro.integrate) {
-      float angle = gyro.angle + gyro.capture_speed * gyro.capture_scale;
+      int64_t angle = gyro.angle + (int64_t)gyro.capture_speed * gyro.capture_scale;
       INTLVL_DISABLE_ALL_BLOCK() {
         gyro.angle = angle;
       }
@@ -431,6 +807,7 @@ static void adxrs_update_angle(uint8_t data[4])
     else {
       // nothing to do
     }
+#endif
   }
 }
 
@@ -448,11 +825,17 @@ void adxrs_capture_manual(float scale)
 
   if(scale != 0) {
     // check response, update angle
-    gyro.capture_scale = scale;
-    adxrs_update_angle(rdata);
+    adxrs_set_capture_scale(scale);
+    adxrs_update_angle(rdata, ADXRS_CAPTURE_TIME());
   } else {
     // reset current speed
     gyro.capture_speed = 0;
+#ifdef ADXRS_TIMESTAMP_TIMER
+    INTLVL_DISABLE_ALL_BLOCK() {
+      adxrs_update_capture_time();
+      gyro.sample_valid = false;
+    }
+#endif
   }
 }
 
@@ -469,7 +852,7 @@ ISR(ADXRS_SPI_INT_vect)
     portpin_outset(&gyro.cspp);
 
     // check response, update angle
-    adxrs_update_angle(data);
+    adxrs_update_angle(data, ADXRS_CAPTURE_TIME());
 
     // first byte of a new command
     portpin_outclr(&gyro.cspp);
@@ -481,5 +864,43 @@ ISR(ADXRS_SPI_INT_vect)
   }
 }
 
+#ifdef ADXRS_DMA_TC
+
+/// DMA interrupt handler for DMA capture mode, called once per capture
+ISR(ADXRS_DMA_CH_RX_vect)
+{
+  portpin_outset(&gyro.cspp);
+#ifdef ADXRS_TIMESTAMP_TIMER
+  // captures are triggered by the TC: derive time from its period, reading
+  // the counter would add the jitter of the interrupt latency
+  gyro.dma_time += gyro.dma_period;
+#endif
+
+  if(ADXRS_DMA_CH_RX.CTRLB & DMA_CH_ERRIF_bm) {
+    // transfer error: drop the capture, restart both channels on the same buffer
+    ADXRS_DMA_CH_TX.CTRLA = 0;
+    ADXRS_DMA_CH_RX.CTRLA = 0;
+    adxrs_dma_arm();
+    portpin_outclr(&gyro.cspp);
+    return;
+  }
+
+  // receive the next capture in the other buffer
+  uint8_t *data = gyro.dma_buffers[gyro.dma_index];
+  gyro.dma_index ^= 1;
+  adxrs_dma_arm();
+
+  // /CS must be high for 100ns, arming channels takes longer than that
+  portpin_outclr(&gyro.cspp);
+
+  // check response, update angle
+#ifdef ADXRS_TIMESTAMP_TIMER
+  adxrs_update_angle(data, gyro.dma_time);
+#else
+  adxrs_update_angle(data, 0);
+#endif
+}
+
+#endif
 
 ///@endcond
@@ -15,6 +15,8 @@
  * value can be retrieved with \ref adxrs_get_angle().
  * A manual capture mode is available; capture are not interrupt-based but
  * triggered manually.
+ * A DMA capture mode is also available: captures are triggered by a TC at a
+ * fixed period and transferred by DMA, with a single interrupt per capture.
  *
  * SM bits (sensor module) are not handled.
  * They are hard-coded to 000 on ADXRS453.
@@ -37,6 +39,13 @@
 #include <avarix/portpin.h>
 
 
+/// Timestamped angle speed sample
+typedef struct {
+  uint32_t time;  ///< capture time, in timer ticks
+  int16_t rate;  ///< angle speed, offset removed
+} adxrs_sample_t;
+
+
 /// ADXRS response type
 typedef enum {
   ADXRS_RESPONSE_NONE = 0,  ///< no response (initial state)
@@ -178,6 +187,14 @@ bool adxrs_startup(void);
  * An alternate mode not using interruptions is available. Values are retrieved
  * manually using \ref adxrs_capture_manual().
  *
+ * If \ref ADXRS_TIMESTAMP_TIMER is defined, captures are timestamped using
+ * the counter of the timer and the angle is integrated using the actual time
+ * between captures, with the trapezoidal rule. Scales are then given per
+ * second and do not depend on the capture period. A sample captured 0x10000
+ * ticks or more after the previous one is not integrated, since wraps of
+ * the counter cannot be counted. The last captured samples can be retrieved
+ * with \ref adxrs_get_samples().
+ *
  * Angle values are in radians, between -Pi and Pi.
  */
 //@{
@@ -189,17 +206,48 @@ bool adxrs_startup(void);
  * Internally, it includes the capture period and the coefficient to convert
  * gyro values to milliradians.
  *
+ * Angle is integrated using fixed-point values, without floating-point
+ * operations in the interrupt handler. Scale is stored on 32 bits with 40
+ * fractional bits: it is saturated to 2^-9 (about 2e-3). Angle range is
+ * about +/-8e6.
+ * With timestamps, it is converted to a scale per timer tick stored with 24
+ * significant bits; the scale per tick is saturated to 2^-15.
+ *
  * Current angle value is reset to 0.
  */
 void adxrs_capture_start(float scale);
 
+/** @brief Start DMA capture mode
+ *
+ * Captures are triggered by overflows of \ref ADXRS_DMA_TC, every \a period
+ * TC ticks. SPI bytes are transferred by DMA, an interrupt is triggered once
+ * the whole response has been received. Sampling period does not depend on
+ * interrupt latency.
+ *
+ * \a period must be long enough for the transfer of 4 SPI bytes and the
+ * processing of the previous capture. \a scale is the same as for
+ * \ref adxrs_capture_start().
+ *
+ * On DMA transfer error, the capture is dropped and DMA channels are re-armed
+ * for the next one.
+ *
+ * With timestamps, sample times are derived from \a period, not read from
+ * the timestamp counter: \ref ADXRS_DMA_PRESCALER_DIV must be a multiple of
+ * \ref ADXRS_TIMESTAMP_PRESCALER_DIV, and samples are integrated only if the
+ * period is lower than 0x10000 timestamp ticks.
+ *
+ * @note Only available if \ref ADXRS_DMA_TC is defined.
+ */
+void adxrs_capture_start_dma(float scale, uint16_t period);
+
 /// Stop capture mode
 void adxrs_capture_stop(void);
 
 /** @brief Manually capture the next angle value
  *
  * \a scale is the value for the current capture and should be based on the
- * time since the previous capture.
+ * time since the previous capture. With timestamps, actual time is used and
+ * \a scale is the same as for \ref adxrs_capture_start().
  *
  * If scale is 0, captured valued is not used. It should be used to initialize
  * the capture.
@@ -223,7 +271,11 @@ bool adxrs_get_calibration_mode(void);
 /// Get current angle value
 float adxrs_get_angle(void);
 
-/// Set current angle value
+/** @brief Set current angle value
+ *
+ * Value is saturated to half the fixed-point range (about +/-4e6), NaN is
+ * ignored.
+ */
 void adxrs_set_angle(float angle);
 
 /// Get current measured angular speed
@@ -235,6 +287,28 @@ int16_t adxrs_get_offset(void);
 /// Get current gyro offset sqsd
 float adxrs_get_offset_sqsd(void);
 
+/** @brief Get current capture time, in timer ticks
+ *
+ * Time is counted from capture start and uses the same base as sample
+ * timestamps. It does not include whole wraps of the counter between two
+ * captures.
+ *
+ * @note Only available if \ref ADXRS_TIMESTAMP_TIMER is defined.
+ */
+uint32_t adxrs_get_capture_time(void);
+
+/** @brief Get the last timestamped samples
+ *
+ * @param samples  buffer to fill, newest sample first
+ * @param n  maximum number of samples to retrieve
+ * @return the number of retrieved samples
+ *
+ * Samples captured in calibration mode are not recorded.
+ *
+ * @note Only available if \ref ADXRS_TIMESTAMP_TIMER is defined.
+ */
+uint8_t adxrs_get_samples(adxrs_sample_t *samples, uint8_t n);
+
 //@}
 
 
@@ -18,5 +18,46 @@
 /// Interrupt level for SPI capture (an \ref intlvl_t value)
 #define ADXRS_CAPTURE_INTLVL  INTLVL_MED
 
+/** @brief Timer used to timestamp captures, as xn
+ *
+ * The counter of TCxn is used as time base. The TC is not configured by this
+ * module: it must be started by the application (for instance, using the
+ * timer module), with the maximum period. Consecutive captures should be less
+ * than 0x10000 ticks apart: a sample captured later is not integrated.
+ * If not defined, captures are not timestamped and a constant capture period
+ * is assumed.
+ */
+//#define ADXRS_TIMESTAMP_TIMER  E0
+
+/// Prescaler factor of the timestamp TC (1, 2, 4, 8, 64, 256 or 1024)
+#define ADXRS_TIMESTAMP_PRESCALER_DIV  1
+
+/** @brief Compare channel of the timestamp TC, used to detect counter wraps
+ *
+ * The channel (A to D, A or B on TCx1) is reserved: its compare value is
+ * moved on each capture, its interrupt must not be enabled.
+ */
+#define ADXRS_TIMESTAMP_CH  D
+
+/// Number of timestamped samples kept for \ref adxrs_get_samples()
+#define ADXRS_SAMPLES_LENGTH  16
+
+/** @brief TC used to trigger DMA captures
+ *
+ * The TC is reserved for ADXRS DMA capture. If not defined, DMA capture
+ * mode is not available.
+ */
+//#define ADXRS_DMA_TC  TCxn
+
+/// Prescaler factor of DMA capture TC (1, 2, 4, 8, 64, 256 or 1024)
+#define ADXRS_DMA_PRESCALER_DIV  1
+
+/// DMA channel receiving SPI bytes, its interrupt is used (0 to 3)
+#define ADXRS_DMA_RX_CH  0
+/// DMA channel sending SPI bytes (0 to 3)
+#define ADXRS_DMA_TX_CH  1
+/// DMA channel starting captures on TC overflows (0 to 3)
+#define ADXRS_DMA_START_CH  2
+
 //@}
 //@}
@@ -8,3 +8,13 @@
 # Add a task executed at regular intervals
 #add_task(name, period, cost)
 
+
+# Add a deferred work, posted from interrupts (highest priority first)
+#add_deferred(name, priority)
+
+# Add a coroutine task, resumed when idle
+#add_coroutine(name)
+
+# Sleep until the next task deadline, using a timer channel to wake up
+# CPU load is measured over the given period (in microseconds)
+#enable_sleep(timer, channel, load_period)
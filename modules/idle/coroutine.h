@@ -0,0 +1,98 @@
+/** @addtogroup idle */
+//@{
+/** @file
+ * @brief Coroutine idle tasks
+ */
+/** @name Coroutines
+ *
+ * Coroutines are stackless tasks (also known as protothreads) resumed by
+ * idle(). They allow to split long operations in small steps without blocking
+ * other tasks.
+ *
+ * A coroutine is a function whose body is enclosed between \ref IDLE_CO_BEGIN
+ * and \ref IDLE_CO_END. Execution is suspended by the \c IDLE_CO_YIELD,
+ * \c IDLE_CO_WAIT_UNTIL and \c IDLE_CO_SLEEP_* macros and resumed on a next
+ * idle() call, at the same place.
+ *
+ * Local variables are not preserved when suspended, persistent data must be
+ * stored elsewhere (for instance in static variables). For the same reason,
+ * coroutine macros must not be used inside a \c switch statement.
+ *
+ * Coroutine tasks are configured in idle_config.py:
+ * \code{.py}
+ * add_coroutine('startup')
+ * \endcode
+ *
+ * Example:
+ * \code
+ * bool gyro_startup(idle_coroutine_t *co)
+ * {
+ *   IDLE_CO_BEGIN(co);
+ *   IDLE_CO_SLEEP_US(co, 100000);
+ *   adxrs_cmd_sensor_data(0, 1);
+ *   IDLE_CO_SLEEP_US(co, 50000);
+ *   ...
+ *   IDLE_CO_END(co);
+ * }
+ * void init(void)
+ * {
+ *   ...
+ *   idle_set_coroutine(startup, gyro_startup);
+ * }
+ * \endcode
+ */
+//@{
+#ifndef IDLE_COROUTINE_H__
+#define IDLE_COROUTINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <timer/uptime.h>
+
+
+/// Coroutine state
+typedef struct {
+  /// Resume point, 0 when not started
+  uint16_t line;
+  /// Uptime before which the coroutine is not resumed
+  uint32_t wakeup;
+
+} idle_coroutine_t;
+
+/** @brief Coroutine function type
+ *
+ * Return true to be resumed again, false when finished.
+ * This value is set by coroutine macros.
+ */
+typedef bool (*idle_coroutine_callback_t)(idle_coroutine_t *co);
+
+
+/// Start a coroutine body
+#define IDLE_CO_BEGIN(co)  switch((co)->line) { case 0:
+
+/// End a coroutine body, the coroutine is not resumed anymore
+#define IDLE_CO_END(co)  } (co)->line = 0; return false
+
+/// Suspend the coroutine until the next idle() call
+#define IDLE_CO_YIELD(co)  do { \
+  (co)->line = __LINE__; return true; case __LINE__:; \
+} while(0)
+
+/// Suspend the coroutine until a condition is true
+#define IDLE_CO_WAIT_UNTIL(co,cond)  do { \
+  (co)->line = __LINE__; if(0) { case __LINE__:; } \
+  if(!(cond)) { return true; } \
+} while(0)
+
+/// Suspend the coroutine until given uptime (in microseconds)
+#define IDLE_CO_SLEEP_UNTIL(co,t)  do { \
+  (co)->wakeup = (t); IDLE_CO_YIELD(co); \
+} while(0)
+
+/// Suspend the coroutine for a given time (in microseconds)
+#define IDLE_CO_SLEEP_US(co,us)  IDLE_CO_SLEEP_UNTIL((co), uptime_us() + (us))
+
+
+#endif
+//@}
+//@}
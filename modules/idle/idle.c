@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <timer/uptime.h>
 #include "idle.h"
 
@@ -14,12 +15,93 @@ typedef struct {
 
 } idle_periodic_task_t;
 
+/// Idle deferred work data
+typedef struct {
+  /// Function called when work is executed
+  idle_callback_t callback;
+  /// True if work has been posted and not executed yet
+  volatile bool pending;
+
+} idle_deferred_t;
+
+/// Idle coroutine task data
+typedef struct {
+  /// Coroutine function, null if not running
+  idle_coroutine_callback_t callback;
+  /// Coroutine state
+  idle_coroutine_t state;
+
+} idle_coroutine_task_t;
+
 
 #include "idle/idle_tasks.inc.c"
 
 
+#ifdef IDLE_SLEEP_TIMER
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#define IDLE_SLEEP_TIMER_T  AVARIX_EVALCONCAT2(timer,IDLE_SLEEP_TIMER)
+
+/// Wake-up timer ticks per microsecond, fixed-point with 16 fractional bits
+#define IDLE_SLEEP_TICKS_PER_US_FP  ((uint32_t)(TIMER_US_TO_TICKS(IDLE_SLEEP_TIMER,1) * 65536 + 0.5f))
+/// Maximum sleep duration, in microseconds, converted ticks fit on 16 bits
+#define IDLE_SLEEP_MAX_US  ((uint32_t)(0xffff0000UL / IDLE_SLEEP_TICKS_PER_US_FP))
+/** @brief Minimum sleep duration, in ticks
+ *
+ * Wake-up compare match must not be reached before the CPU is put to sleep.
+ * It covers the cycles between the check of the counter and sleep_cpu().
+ */
+#define IDLE_SLEEP_MARGIN_TICKS \
+    (2 + 64 / AVARIX_EVALCONCAT3(TIMER,IDLE_SLEEP_TIMER,_PRESCALER_DIV))
+
+_Static_assert(IDLE_SLEEP_TICKS_PER_US_FP > 0, "sleep timer ticks are too long");
+
+/// CPU load measurement data
+static struct {
+  /// Uptime of the current measure start
+  uint32_t start;
+  /// Ticks spent sleeping since measure start
+  uint32_t sleep_ticks;
+  /// Last measured CPU load, in percents
+  uint8_t load;
+
+} idle_load;
+
+static void idle_sleep(void);
+
+/// Uptime used for task deadlines, at sleep timer resolution
+#define idle_uptime_us()  uptime_us_precise()
+
+#else
+
+#define idle_uptime_us()  uptime_us()
+
+#endif
+
+
 void idle(void)
 {
+#if IDLE_DEFERRED_COUNT > 0
+  // restart from the highest priority after each execution, works with a
+  // higher priority may have been posted meanwhile
+  for(uint8_t i=0; i<IDLE_DEFERRED_COUNT; ) {
+    idle_deferred_t *work = &idle_deferred_works[i];
+    if(work->pending) {
+      // clear the flag first: a post occurring while the callback is running
+      // will trigger a new execution
+      work->pending = false;
+      if(work->callback) {
+        work->callback();
+      }
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+#endif
+
 #if IDLE_ALWAYS_TASKS_COUNT > 0
   for(uint8_t i=0; i<IDLE_ALWAYS_TASKS_COUNT; i++) {
     if(idle_always_callbacks[i]) {
@@ -29,7 +111,7 @@ void idle(void)
 #endif
 
 #if IDLE_PERIODIC_TASKS_END > 0
-  uint32_t now = uptime_us();
+  uint32_t now = idle_uptime_us();
   for(uint8_t i=0; i<IDLE_PERIODIC_TASKS_END; i++) {
     idle_periodic_task_t *task = &idle_periodic_tasks[i];
     if(task->callback) {
@@ -40,6 +122,24 @@ void idle(void)
     }
   }
 #endif
+
+#if IDLE_COROUTINES_COUNT > 0
+  uint32_t co_now = idle_uptime_us();
+  for(uint8_t i=0; i<IDLE_COROUTINES_COUNT; i++) {
+    idle_coroutine_task_t *task = &idle_coroutine_tasks[i];
+    if(task->callback) {
+      if(co_now >= task->state.wakeup) {
+        if(!task->callback(&task->state)) {
+          task->callback = 0;
+        }
+      }
+    }
+  }
+#endif
+
+#ifdef IDLE_SLEEP_TIMER
+  idle_sleep();
+#endif
 }
 
 
@@ -59,8 +159,167 @@ void idle_set_callback_(uint8_t index, idle_callback_t cb)
 #if IDLE_PERIODIC_TASKS_END > 0
   {
     idle_periodic_tasks[index].callback = cb;
-    idle_periodic_tasks[index].next = uptime_us();
+    idle_periodic_tasks[index].next = idle_uptime_us();
   }
 #endif
 }
 
+
+#if IDLE_DEFERRED_COUNT > 0
+
+void idle_set_deferred_callback_(uint8_t index, idle_callback_t cb)
+{
+  idle_deferred_works[index].callback = cb;
+}
+
+void idle_post_(uint8_t index)
+{
+  idle_deferred_works[index].pending = true;
+}
+
+#endif
+
+
+#ifdef IDLE_SLEEP_TIMER
+
+#if IDLE_DEFERRED_COUNT > 0
+/// Return true if a deferred work is pending
+static bool idle_deferred_pending(void)
+{
+  for(uint8_t i=0; i<IDLE_DEFERRED_COUNT; i++) {
+    if(idle_deferred_works[i].pending) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+/** @brief Sleep until the next task deadline
+ *
+ * CPU is put in IDLE sleep mode until the earliest periodic task or coroutine
+ * wake-up. The wake-up is scheduled using a compare interrupt on the sleep
+ * timer channel. Any other interrupt also wakes up the CPU.
+ *
+ * Nothing is done if an always task is set or if a task is already late.
+ *
+ * Deadlines are compared to the uptime timer counter, not to the coarse
+ * uptime_us() value, and the sleep duration is rounded to the nearest timer
+ * tick. Wake-up resolution is thus one tick of the sleep timer.
+ *
+ * The wake-up compare is armed with interrupts disabled, from the counter
+ * value read with the deadlines. Sleep is skipped if the deadline is closer
+ * than \ref IDLE_SLEEP_MARGIN_TICKS, the match could be missed otherwise.
+ */
+static void idle_sleep(void)
+{
+  TC0_t *const tc = timer_get_tc(IDLE_SLEEP_TIMER_T);
+  const uint32_t now = idle_uptime_us();
+  const uint16_t now_cnt = tc->CNT;
+
+  // update CPU load
+  const uint32_t elapsed = now - idle_load.start;
+  if(elapsed >= IDLE_LOAD_PERIOD_US) {
+    const uint32_t sleep_us = TIMER_TICKS_TO_US(IDLE_SLEEP_TIMER, idle_load.sleep_ticks);
+    const uint32_t percent_us = (elapsed + 99) / 100;
+    idle_load.load = sleep_us >= elapsed ? 0 : 100 - sleep_us / percent_us;
+    idle_load.start = now;
+    idle_load.sleep_ticks = 0;
+  }
+
+  // compute sleep duration, in microseconds
+  int32_t sleep_us = IDLE_SLEEP_MAX_US;
+#if IDLE_ALWAYS_TASKS_COUNT > 0
+  for(uint8_t i=0; i<IDLE_ALWAYS_TASKS_COUNT; i++) {
+    if(idle_always_callbacks[i]) {
+      return;
+    }
+  }
+#endif
+#if IDLE_PERIODIC_TASKS_END > 0
+  for(uint8_t i=0; i<IDLE_PERIODIC_TASKS_END; i++) {
+    const idle_periodic_task_t *task = &idle_periodic_tasks[i];
+    if(task->callback) {
+      const int32_t dt = task->next - now;
+      if(dt < sleep_us) {
+        sleep_us = dt;
+      }
+    }
+  }
+#endif
+#if IDLE_COROUTINES_COUNT > 0
+  for(uint8_t i=0; i<IDLE_COROUTINES_COUNT; i++) {
+    const idle_coroutine_task_t *task = &idle_coroutine_tasks[i];
+    if(task->callback) {
+      const int32_t dt = task->state.wakeup - now;
+      if(dt < sleep_us) {
+        sleep_us = dt;
+      }
+    }
+  }
+#endif
+
+  if(sleep_us <= 0) {
+    return;
+  }
+  const uint16_t ticks = ((uint32_t)sleep_us * IDLE_SLEEP_TICKS_PER_US_FP + 0x8000) >> 16;
+
+  cli();
+#if IDLE_DEFERRED_COUNT > 0
+  // a work may have been posted since last check
+  if(idle_deferred_pending()) {
+    sei();
+    return;
+  }
+#endif
+  // interrupts executed since the deadline computation shorten the sleep
+  const uint16_t late = tc->CNT - now_cnt;
+  if(late >= ticks || ticks - late < IDLE_SLEEP_MARGIN_TICKS) {
+    sei();
+    return;  // too short, the deadline would be missed
+  }
+  // no callback: the compare interrupt only wakes up the CPU
+  timer_set_oneshot(IDLE_SLEEP_TIMER_T, IDLE_SLEEP_TIMER_CHANNEL, ticks - late, INTLVL_LO, 0);
+  const uint16_t cc = (&tc->CCA)[IDLE_SLEEP_TIMER_CHANNEL - TIMER_CHA];
+  const uint16_t cnt = tc->CNT;
+  if((uint16_t)(cc - cnt) < IDLE_SLEEP_MARGIN_TICKS) {
+    sei();
+    timer_clear_callback(IDLE_SLEEP_TIMER_T, IDLE_SLEEP_TIMER_CHANNEL);
+    return;
+  }
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  // instruction following sei is always executed before pending interrupts
+  sei();
+  sleep_cpu();
+  sleep_disable();
+  // time spent in the interrupt that waked up the CPU is accounted as sleep
+  idle_load.sleep_ticks += (uint16_t)(tc->CNT - cnt);
+  // cancel wake-up if an other interrupt occurred first
+  timer_clear_callback(IDLE_SLEEP_TIMER_T, IDLE_SLEEP_TIMER_CHANNEL);
+}
+
+uint8_t idle_cpu_load(void)
+{
+  return idle_load.load;
+}
+
+#endif
+
+
+#if IDLE_COROUTINES_COUNT > 0
+
+void idle_set_coroutine_(uint8_t index, idle_coroutine_callback_t cb)
+{
+  idle_coroutine_task_t *task = &idle_coroutine_tasks[index];
+  task->callback = cb;
+  task->state.line = 0;
+  task->state.wakeup = 0;
+}
+
+bool idle_coroutine_running_(uint8_t index)
+{
+  return idle_coroutine_tasks[index].callback != 0;
+}
+
+#endif
@@ -26,6 +26,43 @@
  * \endcode
  *
  * Finally, call idle() to execute the tasks, typically when waiting.
+ *
+ * Deferred works allow interrupt routines to delegate heavy processing to
+ * idle(). They are configured in idle_config.py with a priority:
+ * \code{.py}
+ * add_deferred('gyro', 10)
+ * add_deferred('log')  # default priority is 0
+ * \endcode
+ *
+ * An interrupt routine posts a work with idle_post(), which only sets a flag.
+ * On the next idle() call, pending works are executed before other tasks,
+ * highest priority first. Multiple posts of a work before its execution result
+ * in a single execution.
+ * \code
+ * ISR(...)
+ * {
+ *   ...
+ *   idle_post(gyro);
+ * }
+ * void init(void)
+ * {
+ *   ...
+ *   idle_set_deferred_callback(gyro, update_gyro);
+ * }
+ * \endcode
+ *
+ * Long operations can be written as coroutines, see \ref coroutine.h.
+ *
+ * When sleep is enabled in idle_config.py, idle() puts the CPU in IDLE sleep
+ * mode until the next task deadline. A timer channel is used to wake up; its
+ * compare interrupt is a low level interrupt.
+ * \code{.py}
+ * enable_sleep('C0', 'B')  # wake up using TCC0 channel B
+ * \endcode
+ * Deadlines are then checked against uptime_us_precise(), so the wake-up
+ * resolution is one tick of the sleep timer instead of the uptime tick.
+ * Time spent sleeping is used to measure the CPU load, which can be retrieved
+ * with idle_cpu_load().
  */
 //@{
 /**
@@ -35,6 +72,10 @@
 #ifndef IDLE_H__
 #define IDLE_H__
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "coroutine.h"
+
 
 /// Callback type for idle tasks
 typedef void (*idle_callback_t)(void);
@@ -45,6 +86,15 @@ typedef void (*idle_callback_t)(void);
 /// Function to call when idle
 void idle(void);
 
+#if defined(IDLE_SLEEP_TIMER) || DOXYGEN
+/** @brief Get CPU load, in percents
+ *
+ * The load is the ratio of time not spent sleeping in idle(), measured over
+ * the last completed load period.
+ */
+uint8_t idle_cpu_load(void);
+#endif
+
 /** @brief Set the callback of a task
  *
  * If the callback is null, the task is disabled and will not be executed.
@@ -56,6 +106,42 @@ void idle(void);
 void idle_set_callback_(uint8_t index, idle_callback_t cb);
 #endif
 
+/** @brief Set the callback of a deferred work
+ *
+ * If the callback is null, posted work is discarded.
+ */
+#define idle_set_deferred_callback(work,callback) \
+    idle_set_deferred_callback_(IDLE_DEFERRED_##work, (callback))
+
+/** @brief Post a deferred work, to be executed on next idle() call
+ *
+ * This macro is intended to be used in interrupt routines.
+ * It executes in constant time and does not disable interrupts.
+ */
+#define idle_post(work)  idle_post_(IDLE_DEFERRED_##work)
+
+#ifndef DOXYGEN
+void idle_set_deferred_callback_(uint8_t index, idle_callback_t cb);
+void idle_post_(uint8_t index);
+#endif
+
+/** @brief Start a coroutine task
+ *
+ * The coroutine is restarted from the beginning. If the callback is null, the
+ * coroutine is stopped.
+ */
+#define idle_set_coroutine(task,callback) \
+    idle_set_coroutine_(IDLE_COROUTINE_##task, (callback))
+
+/// Return true if a coroutine task is running
+#define idle_coroutine_running(task) \
+    idle_coroutine_running_(IDLE_COROUTINE_##task)
+
+#ifndef DOXYGEN
+void idle_set_coroutine_(uint8_t index, idle_coroutine_callback_t cb);
+bool idle_coroutine_running_(uint8_t index);
+#endif
+
 
 #endif
 //@}
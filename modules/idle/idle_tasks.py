@@ -13,10 +13,14 @@ def lcm(a, b):
   return a * b // gcd(a, b)
 
 
+def check_name(name):
+  if not re.match(r'^[a-zA-Z][a-zA-Z0-9_]*$', name):
+    raise ValueError("invalid task name: %s" % name)
+
+
 class Task:
   def __init__(self, name, period, cost=None):
-    if not re.match(r'^[a-zA-Z][a-zA-Z0-9_]*$', name):
-      raise ValueError("invalid task name: %s" % name)
+    check_name(name)
     if period is None:
       if cost is not None:
         raise ValueError("unexpected cost for task '%s' with no period" % name)
@@ -31,12 +35,22 @@ class Task:
     self.offset = None
 
 
+class Deferred:
+  def __init__(self, name, priority):
+    check_name(name)
+    self.name = name
+    self.priority = int(priority)
+
+
 class CodeGenerator:
   """
   Generate code from a script with task configuration
 
   Attribute:
     tasks -- list of tasks
+    deferred -- list of deferred works, highest priority first
+    coroutines -- list of coroutine task names
+    sleep -- sleep configuration (timer, channel, load period), or None
     min_period -- minimum task period
     slots -- list of execution slots, each slot is a list of tasks
 
@@ -45,6 +59,9 @@ class CodeGenerator:
   def __init__(self, script):
     self.min_period = None
     self.tasks = []
+    self.deferred = []
+    self.coroutines = []
+    self.sleep = None
 
     # methods used in the script to define tasks
     def set_min_period(period):
@@ -53,11 +70,27 @@ class CodeGenerator:
       self.min_period = int(period)
     def add_task(name, period, cost=None):
       self.tasks.append(Task(name, period, cost))
+    def add_deferred(name, priority=0):
+      self.deferred.append(Deferred(name, priority))
+    def add_coroutine(name):
+      check_name(name)
+      self.coroutines.append(name)
+    def enable_sleep(timer, channel, load_period=100000):
+      if not re.match(r'^[C-F][01]$', timer):
+        raise ValueError("invalid sleep timer: %s" % timer)
+      if channel not in 'ABCD' or (timer[1] == '1' and channel not in 'AB'):
+        raise ValueError("invalid sleep timer channel: %s" % channel)
+      if load_period <= 0:
+        raise ValueError("invalid load period")
+      self.sleep = (timer, channel, int(load_period))
 
     script_globals = {}
     script_locals = {
         'set_min_period': set_min_period,
         'add_task': add_task,
+        'add_deferred': add_deferred,
+        'add_coroutine': add_coroutine,
+        'enable_sleep': enable_sleep,
         }
     with open(script) as f:
       exec(f.read(), script_globals, script_locals)
@@ -77,6 +110,16 @@ class CodeGenerator:
           raise ValueError("period too low for task '%s'" % task.name)
         if task.period % self.min_period != 0:
           raise ValueError("period of task '%s' not a multiple of min period" % task.name)
+    names = set()
+    for work in self.deferred:
+      if work.name in names:
+        raise ValueError("duplicate deferred work name: %s" % work.name)
+      names.add(work.name)
+    if len(set(self.coroutines)) != len(self.coroutines):
+      raise ValueError("duplicate coroutine name")
+
+    # sort deferred works by priority, keep declaration order for equal ones
+    self.deferred.sort(key=lambda w: w.priority, reverse=True)
 
     self.solve()
 
@@ -147,6 +190,39 @@ class CodeGenerator:
   def idle_always_tasks_size(self):
     return len(self.tasks) - self.periodic_tasks_end()
 
+  def deferred_name_enum(self):
+    if not self.deferred:
+      return ''
+    ret = 'typedef enum {\n'
+    for work in self.deferred:
+      ret += "  IDLE_DEFERRED_%s,\n" % work.name
+    ret += '} idle_deferred_name_t;\n'
+    return ret
+
+  def deferred_size(self):
+    return len(self.deferred)
+
+  def coroutine_name_enum(self):
+    if not self.coroutines:
+      return ''
+    ret = 'typedef enum {\n'
+    for name in self.coroutines:
+      ret += "  IDLE_COROUTINE_%s,\n" % name
+    ret += '} idle_coroutine_name_t;\n'
+    return ret
+
+  def coroutines_size(self):
+    return len(self.coroutines)
+
+  def sleep_defines(self):
+    if self.sleep is None:
+      return ''
+    return (
+        "#define IDLE_SLEEP_TIMER  %s\n"
+        "#define IDLE_SLEEP_TIMER_CHANNEL  '%s'\n"
+        "#define IDLE_LOAD_PERIOD_US  %u\n"
+        ) % self.sleep
+
   def idle_periodic_tasks(self):
     ret = ''
     for task in self.tasks:
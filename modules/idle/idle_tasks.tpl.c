@@ -2,6 +2,8 @@
 
 #define IDLE_PERIODIC_TASKS_END  $$avarix:self.periodic_tasks_end()$$
 #define IDLE_ALWAYS_TASKS_COUNT  $$avarix:self.idle_always_tasks_size()$$
+#define IDLE_DEFERRED_COUNT  $$avarix:self.deferred_size()$$
+#define IDLE_COROUTINES_COUNT  $$avarix:self.coroutines_size()$$
 
 #if IDLE_ALWAYS_TASKS_COUNT > 0
 static idle_callback_t idle_always_callbacks[IDLE_ALWAYS_TASKS_COUNT];
@@ -13,3 +15,10 @@ static idle_periodic_task_t idle_periodic_tasks[] = {
 };
 #endif
 
+#if IDLE_DEFERRED_COUNT > 0
+static idle_deferred_t idle_deferred_works[IDLE_DEFERRED_COUNT];
+#endif
+
+#if IDLE_COROUTINES_COUNT > 0
+static idle_coroutine_task_t idle_coroutine_tasks[IDLE_COROUTINES_COUNT];
+#endif
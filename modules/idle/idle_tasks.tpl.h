@@ -1,4 +1,10 @@
+#pragma avarix_tpl self.sleep_defines()
+
 typedef enum {
 #pragma avarix_tpl self.task_name_enum()
 } idle_task_name_t;
 
+
+#pragma avarix_tpl self.deferred_name_enum()
+
+#pragma avarix_tpl self.coroutine_name_enum()
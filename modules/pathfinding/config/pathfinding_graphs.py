@@ -1,4 +1,14 @@
 set_max_path_size(10)
+# optional: number of search results cached in path finders
+#set_cache_size(4)
+# optional: count search statistics in path finders
+#set_stats(True)
+# optional: enable node reservations, to plan paths of two robots
+#set_reservations(True)
+# optional: use a static workspace for blocking searches, instead of the stack
+#set_static_workspace(True)
+# optional: maximum size of a search workspace, in bytes, checked at compile time
+#set_max_workspace_size(1024)
 
 add_graph('graph', {
   # nodes: {name: (x, y)}
@@ -9,5 +19,8 @@ add_graph('graph', {
   # vertices: [(node1, node2)]
   ('alpha', 'beta'),
   ('beta', 'gamma'),
-])
+],
+  # optional: number of landmarks used to improve the search heuristic
+  #landmarks=2,
+)
 
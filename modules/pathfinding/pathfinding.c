@@ -1,5 +1,14 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#ifdef HOST_VERSION
+# define PROGMEM
+# define pgm_read_byte(p)  (*(const uint8_t *)(p))
+# define pgm_read_word(p)  (*(const uint16_t *)(p))
+#else
+# include <avr/pgmspace.h>
+#endif
 #include "pathfinding.h"
 #include "pathfinding/pathfinding_graphs.inc.c"
 
@@ -7,7 +16,13 @@
 #define PATHFINDING_COST_MAX  0xffffffff
 
 
-static uint32_t vertex_cost(const pathfinding_node_t *start, const pathfinding_node_t *goal)
+/** @brief Return the distance between two nodes
+ *
+ * Vertex costs are rounded up, as costs generated by pathfinding_graphs.py.
+ * Heuristics are rounded down. Otherwise, rounding errors would accumulate
+ * along paths and make heuristics inconsistent.
+ */
+static uint32_t vertex_length(const pathfinding_node_t *start, const pathfinding_node_t *goal, bool round_up)
 {
   const int16_t dx = start->x - goal->x;
   const int16_t dy = start->y - goal->y;
@@ -28,15 +43,223 @@ static uint32_t vertex_cost(const pathfinding_node_t *start, const pathfinding_n
     }
     bit >>= 2;
   }
-  return res;
+  // c is now the remainder
+  return round_up && c ? res + 1 : res;
 }
 
+/// Return the cost of a vertex between two nodes
+#define vertex_cost(start, goal)  vertex_length((start), (goal), true)
+/// Return the heuristic cost between two nodes
+#define vertex_heuristic(start, goal)  vertex_length((start), (goal), false)
+
 #define FINDER_VERTEX_COST(finder, index0, index1) \
     vertex_cost(&(finder)->nodes[index0], &(finder)->nodes[index1])
+#define FINDER_VERTEX_HEURISTIC(finder, index0, index1) \
+    vertex_heuristic(&(finder)->nodes[index0], &(finder)->nodes[index1])
 
+/// Read a node index from program memory
+#define pgm_read_index(p) \
+    (sizeof(pathfinding_index_t) == 1 ? pgm_read_byte(p) : pgm_read_word(p))
 
-/// Return true if node is blocked by obstacle
-static bool obstacle_blocks_node(const pathfinding_obstacle_t *obstacle, const pathfinding_node_t *node)
+/// Read graph vertices, stored in program memory
+#define FINDER_OFFSET(finder, index_node)  pgm_read_word(&(finder)->offsets[index_node])
+#define FINDER_NEIGHBOR(finder, index_vertex)  pgm_read_index(&(finder)->neighbors[index_vertex])
+#define FINDER_COST(finder, index_vertex)  pgm_read_word(&(finder)->costs[index_vertex])
+/// Read nodes grid, stored in program memory
+#define GRID_OFFSET(grid, cell)  pgm_read_word(&(grid)->offsets[cell])
+#define GRID_NODE(grid, k)  pgm_read_index(&(grid)->nodes[k])
+
+/// Increment a search statistics counter
+#if PATHFINDING_STATS
+# define FINDER_STATS_INC(finder, counter)  ((finder)->stats.counter++)
+#else
+# define FINDER_STATS_INC(finder, counter)
+#endif
+
+/// Distance in landmark tables for unreachable nodes
+#define LANDMARK_UNREACHABLE  0xffff
+
+/** @brief Return the heuristic cost between two nodes
+ *
+ * Use the best of vertex cost and triangle inequality bounds from landmarks.
+ */
+static uint32_t finder_heuristic(const pathfinding_t *finder, pathfinding_index_t index0, pathfinding_index_t index1)
+{
+  uint32_t h = FINDER_VERTEX_HEURISTIC(finder, index0, index1);
+  const pathfinding_landmarks_t *landmarks = finder->landmarks;
+  if(landmarks) {
+    const uint16_t *distances = landmarks->distances;
+    for(uint8_t i=0; i<landmarks->size; i++) {
+      const uint16_t d0 = pgm_read_word(&distances[index0]);
+      const uint16_t d1 = pgm_read_word(&distances[index1]);
+      if(d0 != LANDMARK_UNREACHABLE && d1 != LANDMARK_UNREACHABLE) {
+        const uint16_t d = d0 > d1 ? d0 - d1 : d1 - d0;
+        if(d > h) {
+          h = d;
+        }
+      }
+      distances += finder->nodes_size;
+    }
+  }
+  return h;
+}
+
+
+#define BITMAP_GET(bitmap, i)  (((bitmap)[(i)/8] >> ((i)%8)) & 1)
+#define BITMAP_SET(bitmap, i)  ((bitmap)[(i)/8] |= 1 << ((i)%8))
+#define BITMAP_CLEAR(bitmap, i)  ((bitmap)[(i)/8] &= ~(1 << ((i)%8)))
+
+
+/// Range of grid cells, bounds included
+typedef struct {
+  uint8_t column0, column1;
+  uint8_t row0, row1;
+} grid_range_t;
+
+/** @brief Get grid cells overlapping a box
+ *
+ * @return false if the box does not overlap the grid.
+ */
+static bool grid_range(const pathfinding_grid_t *grid, int32_t xmin, int32_t ymin,
+                       int32_t xmax, int32_t ymax, grid_range_t *range)
+{
+  xmin -= grid->x;
+  xmax -= grid->x;
+  ymin -= grid->y;
+  ymax -= grid->y;
+  const int32_t width = (int32_t)grid->columns * grid->cell;
+  const int32_t height = (int32_t)grid->rows * grid->cell;
+  if(xmax < 0 || ymax < 0 || xmin >= width || ymin >= height) {
+    return false;
+  }
+  range->column0 = xmin < 0 ? 0 : xmin / grid->cell;
+  range->column1 = xmax >= width ? grid->columns - 1 : xmax / grid->cell;
+  range->row0 = ymin < 0 ? 0 : ymin / grid->cell;
+  range->row1 = ymax >= height ? grid->rows - 1 : ymax / grid->cell;
+  return true;
+}
+
+
+/// Bounding box of an obstacle, bounds excluded
+typedef struct {
+  int32_t xmin, ymin;
+  int32_t xmax, ymax;
+} obstacle_box_t;
+
+/// Get the bounding box of an obstacle
+static void obstacle_box(const pathfinding_obstacle_t *o, obstacle_box_t *box)
+{
+  int16_t dxmin, dymin, dxmax, dymax;
+  switch(o->shape) {
+    case PATHFINDING_OBSTACLE_RECTANGLE:
+      dxmin = -o->dx;
+      dxmax = o->dx;
+      dymin = -o->dy;
+      dymax = o->dy;
+      break;
+    case PATHFINDING_OBSTACLE_SEGMENT:
+      dxmin = o->dx < 0 ? o->dx : 0;
+      dxmax = o->dx < 0 ? 0 : o->dx;
+      dymin = o->dy < 0 ? o->dy : 0;
+      dymax = o->dy < 0 ? 0 : o->dy;
+      break;
+    case PATHFINDING_OBSTACLE_POLYGON:
+      dxmin = dxmax = o->points[0].x;
+      dymin = dymax = o->points[0].y;
+      for(uint8_t i=1; i<o->points_size; i++) {
+        const pathfinding_node_t *p = &o->points[i];
+        if(p->x < dxmin) {
+          dxmin = p->x;
+        } else if(p->x > dxmax) {
+          dxmax = p->x;
+        }
+        if(p->y < dymin) {
+          dymin = p->y;
+        } else if(p->y > dymax) {
+          dymax = p->y;
+        }
+      }
+      break;
+    case PATHFINDING_OBSTACLE_CIRCLE:
+    default:
+      dxmin = dymin = -o->r;
+      dxmax = dymax = o->r;
+      break;
+  }
+  box->xmin = (int32_t)o->x + dxmin;
+  box->xmax = (int32_t)o->x + dxmax;
+  box->ymin = (int32_t)o->y + dymin;
+  box->ymax = (int32_t)o->y + dymax;
+}
+
+
+/// Return the cross product of AB and AC
+static int32_t cross(const pathfinding_node_t *a, const pathfinding_node_t *b, const pathfinding_node_t *c)
+{
+  const int16_t dx_ab = b->x - a->x;
+  const int16_t dy_ab = b->y - a->y;
+  const int16_t dx_ac = c->x - a->x;
+  const int16_t dy_ac = c->y - a->y;
+  return (int32_t)dx_ab * dy_ac - (int32_t)dy_ab * dx_ac;
+}
+
+/// Return polygon orientation: 1 if counter-clockwise, -1 if clockwise, 0 if flat
+static int8_t polygon_orientation(const pathfinding_node_t *points, uint8_t size)
+{
+  for(uint8_t i=2; i<size; i++) {
+    const int32_t c = cross(&points[0], &points[1], &points[i]);
+    if(c) {
+      return c > 0 ? 1 : -1;
+    }
+  }
+  return 0;
+}
+
+/// Return true if a point is strictly inside a convex polygon
+static bool polygon_blocks_node(const pathfinding_node_t *points, uint8_t size, const pathfinding_node_t *a)
+{
+  const int8_t orientation = polygon_orientation(points, size);
+  if(orientation == 0) {
+    return false;
+  }
+  for(uint8_t i=0; i<size; i++) {
+    const int32_t c = cross(&points[i], &points[i+1 < size ? i+1 : 0], a);
+    if(orientation > 0 ? c <= 0 : c >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** @brief Return true if a segment crosses the interior of a convex polygon
+ *
+ * Use the separating axis theorem: AB is clear if it is outside one of the
+ * polygon edges, or if the polygon is on one side of AB.
+ * A flat polygon, for instance a segment, blocks segments crossing it.
+ */
+static bool polygon_blocks_vertex(const pathfinding_node_t *points, uint8_t size,
+                                  const pathfinding_node_t *a, const pathfinding_node_t *b)
+{
+  const int8_t orientation = polygon_orientation(points, size);
+  bool left = false, right = false;
+  for(uint8_t i=0; i<size; i++) {
+    const pathfinding_node_t *p = &points[i];
+    const pathfinding_node_t *q = &points[i+1 < size ? i+1 : 0];
+    const int32_t ca = cross(p, q, a);
+    const int32_t cb = cross(p, q, b);
+    if((orientation >= 0 && ca <= 0 && cb <= 0) || (orientation <= 0 && ca >= 0 && cb >= 0)) {
+      return false;
+    }
+    const int32_t c = cross(a, b, p);
+    left = left || c > 0;
+    right = right || c < 0;
+  }
+  return left && right;
+}
+
+
+/// Return true if node is blocked by a circle obstacle
+static bool circle_blocks_node(const pathfinding_obstacle_t *obstacle, const pathfinding_node_t *node)
 {
   const int16_t dx = node->x - obstacle->x;
   const int16_t dy = node->y - obstacle->y;
@@ -44,6 +267,27 @@ static bool obstacle_blocks_node(const pathfinding_obstacle_t *obstacle, const p
   return (int32_t)dx*dx + (int32_t)dy*dy < r*r;
 }
 
+/// Return true if node is blocked by obstacle
+static bool obstacle_blocks_node(const pathfinding_obstacle_t *o, const pathfinding_node_t *node)
+{
+  switch(o->shape) {
+    case PATHFINDING_OBSTACLE_RECTANGLE: {
+      const int32_t dx = (int32_t)node->x - o->x;
+      const int32_t dy = (int32_t)node->y - o->y;
+      return dx < o->dx && dx > -o->dx && dy < o->dy && dy > -o->dy;
+    }
+    case PATHFINDING_OBSTACLE_SEGMENT:
+      return false;
+    case PATHFINDING_OBSTACLE_POLYGON: {
+      const pathfinding_node_t p = { node->x - o->x, node->y - o->y };
+      return polygon_blocks_node(o->points, o->points_size, &p);
+    }
+    case PATHFINDING_OBSTACLE_CIRCLE:
+    default:
+      return circle_blocks_node(o, node);
+  }
+}
+
 /// Return true if a node is blocked by any obstacle
 static bool node_blocked(const pathfinding_t *finder, const pathfinding_node_t *a)
 {
@@ -55,12 +299,10 @@ static bool node_blocked(const pathfinding_t *finder, const pathfinding_node_t *
   return false;
 }
 
-#define FINDER_NODE_BLOCKED(finder, index_node) \
-    node_blocked((finder), &(finder)->nodes[index_node])
 
 
-/// Return true if vertex is blocked by obstacle
-static bool obstacle_blocks_vertex(const pathfinding_obstacle_t *o, const pathfinding_node_t *a, const pathfinding_node_t *b)
+/// Return true if vertex is blocked by a circle obstacle
+static bool circle_blocks_vertex(const pathfinding_obstacle_t *o, const pathfinding_node_t *a, const pathfinding_node_t *b)
 {
   const int16_t dx_ao = o->x - a->x;
   const int16_t dy_ao = o->y - a->y;
@@ -82,129 +324,1397 @@ static bool obstacle_blocks_vertex(const pathfinding_obstacle_t *o, const pathfi
     return false;
   }
   // The obstacle intersects if:  OP² = AO² - u² / AB² < r²
-  const uint32_t u2_ab2 = ((uint64_t)u * u) / d2_ab;
-  return d2_ao - u2_ab2 < (uint32_t)o->r * o->r;
+  // compared without division:  AO² * AB² - u² < r² * AB²
+  const uint32_t r2 = (uint32_t)o->r * o->r;
+  return (uint64_t)d2_ao * d2_ab - (uint64_t)u * u < (uint64_t)r2 * d2_ab;
+}
+
+/// Return true if vertex is blocked by a rectangle obstacle
+static bool rectangle_blocks_vertex(const pathfinding_obstacle_t *o, const pathfinding_node_t *a, const pathfinding_node_t *b)
+{
+  // separating axes of the rectangle are checked by the bounding boxes
+  const int16_t x0 = o->x - o->dx;
+  const int16_t x1 = o->x + o->dx;
+  const int16_t y0 = o->y - o->dy;
+  const int16_t y1 = o->y + o->dy;
+  if((a->x <= x0 && b->x <= x0) || (a->x >= x1 && b->x >= x1) ||
+     (a->y <= y0 && b->y <= y0) || (a->y >= y1 && b->y >= y1)) {
+    return false;
+  }
+  // remaining axis: the rectangle must be on both sides of AB
+  const pathfinding_node_t corners[4] = { {x0, y0}, {x1, y0}, {x1, y1}, {x0, y1} };
+  bool left = false, right = false;
+  for(uint8_t i=0; i<4; i++) {
+    const int32_t c = cross(a, b, &corners[i]);
+    left = left || c > 0;
+    right = right || c < 0;
+  }
+  return left && right;
+}
+
+/// Return true if vertex is blocked by obstacle
+static bool obstacle_blocks_vertex(const pathfinding_obstacle_t *o, const pathfinding_node_t *a, const pathfinding_node_t *b)
+{
+  switch(o->shape) {
+    case PATHFINDING_OBSTACLE_RECTANGLE:
+      return rectangle_blocks_vertex(o, a, b);
+    case PATHFINDING_OBSTACLE_SEGMENT: {
+      const pathfinding_node_t points[2] = { {0, 0}, {o->dx, o->dy} };
+      const pathfinding_node_t pa = { a->x - o->x, a->y - o->y };
+      const pathfinding_node_t pb = { b->x - o->x, b->y - o->y };
+      return polygon_blocks_vertex(points, 2, &pa, &pb);
+    }
+    case PATHFINDING_OBSTACLE_POLYGON: {
+      const pathfinding_node_t pa = { a->x - o->x, a->y - o->y };
+      const pathfinding_node_t pb = { b->x - o->x, b->y - o->y };
+      return polygon_blocks_vertex(o->points, o->points_size, &pa, &pb);
+    }
+    case PATHFINDING_OBSTACLE_CIRCLE:
+    default:
+      return circle_blocks_vertex(o, a, b);
+  }
+}
+
+/// Return true if a node is in the bounding box of an obstacle
+static bool obstacle_box_has_node(const pathfinding_obstacle_t *o, const pathfinding_node_t *a)
+{
+  obstacle_box_t box;
+  obstacle_box(o, &box);
+  return a->x > box.xmin && a->x < box.xmax && a->y > box.ymin && a->y < box.ymax;
+}
+
+/// Return true if a vertex bounding box intersects the bounding box of an obstacle
+static bool obstacle_box_has_vertex(const pathfinding_obstacle_t *o, const pathfinding_node_t *a, const pathfinding_node_t *b)
+{
+  const int32_t xmin = a->x < b->x ? a->x : b->x;
+  const int32_t xmax = a->x < b->x ? b->x : a->x;
+  const int32_t ymin = a->y < b->y ? a->y : b->y;
+  const int32_t ymax = a->y < b->y ? b->y : a->y;
+  obstacle_box_t box;
+  obstacle_box(o, &box);
+  return xmin < box.xmax && xmax > box.xmin && ymin < box.ymax && ymax > box.ymin;
 }
 
 /// Return true if a vertex is blocked by any obstacle
 static bool vertex_blocked(const pathfinding_t *finder, const pathfinding_node_t *a, const pathfinding_node_t *b)
 {
   for(uint8_t i=0; i<finder->obstacles_size; i++) {
-    if(obstacle_blocks_vertex(&finder->obstacles[i], a, b)) {
+    const pathfinding_obstacle_t *o = &finder->obstacles[i];
+    if(obstacle_box_has_vertex(o, a, b) && obstacle_blocks_vertex(o, a, b)) {
       return true;
     }
   }
   return false;
 }
 
-#define FINDER_VERTEX_BLOCKED(finder, index_a, index_b) \
-    vertex_blocked((finder), &(finder)->nodes[index_a], &(finder)->nodes[index_b])
+
+/// Return true if a node is blocked, using the cache
+#define FINDER_NODE_BLOCKED(finder, index_node) \
+    BITMAP_GET((finder)->blocked_nodes, (index_node))
+
+/// Return true if a vertex is blocked, using the cache
+#define FINDER_VERTEX_BLOCKED(finder, index_vertex) \
+    BITMAP_GET((finder)->blocked_vertices, (index_vertex))
 
 
-void pathfinding_search(pathfinding_t *finder, uint8_t start, uint8_t goal)
+/** @brief Update cached blocked state in the area of an obstacle
+ *
+ * If \e all is true, nodes and vertices in the area are checked against all
+ * obstacles. Otherwise, they are only checked against \e area itself, which
+ * is enough for a newly added obstacle.
+ *
+ * Only nodes in grid cells near the area are visited: a vertex crossing the
+ * area has both nodes within the longest vertex length of it.
+ */
+static void update_obstacle_area(pathfinding_t *finder, const pathfinding_obstacle_t *area, bool all)
 {
-  struct {
-    enum { PENDING, OPEN, CLOSED } state;
-    uint8_t previous;  // most efficicient previous node (0xff for start)
-    uint32_t partial_cost;  // cost from start (squared distance)
-    uint32_t total_cost;  // estimated total cost (squared distance)
-  } astar_nodes[finder->nodes_size];
+  const pathfinding_grid_t *grid = finder->grid;
+  grid_range_t range = { 0, 0, 0, 0 };
+  if(grid) {
+    obstacle_box_t box;
+    obstacle_box(area, &box);
+    const int32_t margin = grid->vertex_length;
+    if(!grid_range(grid, box.xmin - margin, box.ymin - margin,
+                   box.xmax + margin, box.ymax + margin, &range)) {
+      return;
+    }
+  }
 
-  // initialize astar_nodes
-  // consider blocked nodes as already visited
-  for(uint8_t i=0; i<finder->nodes_size; i++) {
-    astar_nodes[i].state = PENDING;
-    astar_nodes[i].partial_cost = PATHFINDING_COST_MAX;
-    astar_nodes[i].total_cost = PATHFINDING_COST_MAX;
+  for(uint8_t row=range.row0; row<=range.row1; row++) {
+    for(uint8_t column=range.column0; column<=range.column1; column++) {
+      uint16_t k0 = 0, k1 = finder->nodes_size;
+      if(grid) {
+        const uint16_t cell = row * grid->columns + column;
+        k0 = GRID_OFFSET(grid, cell);
+        k1 = GRID_OFFSET(grid, cell+1);
+      }
+      for(uint16_t k=k0; k<k1; k++) {
+        const pathfinding_index_t i = grid ? GRID_NODE(grid, k) : k;
+        const pathfinding_node_t *node = &finder->nodes[i];
+        if(obstacle_box_has_node(area, node)) {
+          if(all ? node_blocked(finder, node) : obstacle_blocks_node(area, node)) {
+            BITMAP_SET(finder->blocked_nodes, i);
+          } else if(all) {
+            BITMAP_CLEAR(finder->blocked_nodes, i);
+          }
+        }
+        for(uint16_t index=FINDER_OFFSET(finder, i), end=FINDER_OFFSET(finder, i+1); index<end; index++) {
+          const pathfinding_node_t *neighbor = &finder->nodes[FINDER_NEIGHBOR(finder, index)];
+          if(obstacle_box_has_vertex(area, node, neighbor)) {
+            if(all ? vertex_blocked(finder, node, neighbor) : obstacle_blocks_vertex(area, node, neighbor)) {
+              BITMAP_SET(finder->blocked_vertices, index);
+            } else if(all) {
+              BITMAP_CLEAR(finder->blocked_vertices, index);
+            }
+          }
+        }
+      }
+    }
   }
+}
 
-  // start node must not be blocked
-  if(FINDER_NODE_BLOCKED(finder, start)) {
-    goto fail;
+#if PATHFINDING_CACHE_SIZE
+
+/// Clear cached search results
+static void cache_clear(pathfinding_t *finder)
+{
+  for(uint8_t i=0; i<PATHFINDING_CACHE_SIZE; i++) {
+    finder->cache[i].start = PATHFINDING_INDEX_NONE;
+    finder->cache[i].rank = i;
   }
+}
 
-  // initialize start node
-  astar_nodes[start].state = OPEN;
-  astar_nodes[start].previous = 0xff;
-  astar_nodes[start].partial_cost = 0;
-  astar_nodes[start].total_cost = FINDER_VERTEX_COST(finder, start, goal);
+/// Mark a cache entry as the most recently used
+static void cache_touch(pathfinding_t *finder, pathfinding_cache_entry_t *entry)
+{
+  for(uint8_t i=0; i<PATHFINDING_CACHE_SIZE; i++) {
+    if(finder->cache[i].rank < entry->rank) {
+      finder->cache[i].rank++;
+    }
+  }
+  entry->rank = 0;
+}
 
-  for(;;) {
-    // find node with lowest estimated cost
-    uint8_t current = 0xff;
-    uint32_t min_cost = PATHFINDING_COST_MAX;
-    for(uint8_t i=0; i<finder->nodes_size; i++) {
-      if(astar_nodes[i].state == OPEN) {
-        if(astar_nodes[i].total_cost < min_cost) {
-          min_cost = astar_nodes[i].total_cost;
-          current = i;
-        }
-      }
+/// Return the cached result of a search, NULL if not cached
+static pathfinding_cache_entry_t *cache_find(pathfinding_t *finder, pathfinding_index_t start, pathfinding_index_t goal)
+{
+#if PATHFINDING_RESERVATIONS
+  if(finder->reservations_size) {
+    return NULL;
+  }
+#endif
+  for(uint8_t i=0; i<PATHFINDING_CACHE_SIZE; i++) {
+    pathfinding_cache_entry_t *entry = &finder->cache[i];
+    if(entry->start == start && entry->goal == goal &&
+       entry->epoch == finder->epoch && entry->any_angle == finder->any_angle) {
+      return entry;
     }
+  }
+  return NULL;
+}
 
-    if(current == 0xff) {
-      goto fail;
-    } else if(current == goal) {
-      // re build path: get size, then fill values
-      uint8_t path_size = 1;  // +1 for starting node
-      for(uint8_t i=current; i!=start; i=astar_nodes[i].previous) {
-        path_size++;
-      }
-      finder->path_size = path_size;
-      for(uint8_t i=current; i!=start; i=astar_nodes[i].previous) {
-        finder->path[--path_size] = i;
+/// Store the result of the completed search, replace the least recently used entry
+static void cache_store(pathfinding_t *finder)
+{
+  pathfinding_cache_entry_t *entry = &finder->cache[0];
+  for(uint8_t i=1; i<PATHFINDING_CACHE_SIZE; i++) {
+    if(finder->cache[i].rank > entry->rank) {
+      entry = &finder->cache[i];
+    }
+  }
+  entry->start = finder->start;
+  entry->goal = finder->goal;
+  entry->epoch = finder->epoch;
+  entry->any_angle = finder->any_angle;
+  entry->cost = finder->path_cost;
+  entry->path_size = finder->path_size;
+  memcpy(entry->path, finder->path, finder->path_size * sizeof(*finder->path));
+#if PATHFINDING_RESERVATIONS
+  memcpy(entry->path_times, finder->path_times, finder->path_size * sizeof(*finder->path_times));
+#endif
+  cache_touch(finder, entry);
+}
+
+#endif
+
+void pathfinding_update_obstacles(pathfinding_t *finder)
+{
+  for(pathfinding_index_t i=0; i<finder->nodes_size; i++) {
+    const pathfinding_node_t *node = &finder->nodes[i];
+    if(node_blocked(finder, node)) {
+      BITMAP_SET(finder->blocked_nodes, i);
+    } else {
+      BITMAP_CLEAR(finder->blocked_nodes, i);
+    }
+    for(uint16_t index=FINDER_OFFSET(finder, i), end=FINDER_OFFSET(finder, i+1); index<end; index++) {
+      if(vertex_blocked(finder, node, &finder->nodes[FINDER_NEIGHBOR(finder, index)])) {
+        BITMAP_SET(finder->blocked_vertices, index);
+      } else {
+        BITMAP_CLEAR(finder->blocked_vertices, index);
       }
-      finder->path[0] = start;
-      return;
     }
+  }
+  finder->epoch++;
+  finder->blocked_valid = true;
+#if PATHFINDING_CACHE_SIZE
+  cache_clear(finder);
+#endif
+}
+
+/// Update blocked nodes and vertices if nodes or obstacles have been set
+static void finder_check_obstacles(pathfinding_t *finder)
+{
+  if(!finder->blocked_valid) {
+    pathfinding_update_obstacles(finder);
+  }
+}
+
+void pathfinding_obstacle_added(pathfinding_t *finder, uint8_t index)
+{
+  if(!finder->blocked_valid) {
+    pathfinding_update_obstacles(finder);
+    return;
+  }
+  update_obstacle_area(finder, &finder->obstacles[index], false);
+  finder->epoch++;
+}
+
+void pathfinding_obstacle_moved(pathfinding_t *finder, uint8_t index, const pathfinding_obstacle_t *old)
+{
+  if(!finder->blocked_valid) {
+    pathfinding_update_obstacles(finder);
+    return;
+  }
+  update_obstacle_area(finder, old, true);
+  update_obstacle_area(finder, &finder->obstacles[index], false);
+  finder->epoch++;
+}
+
+void pathfinding_obstacle_removed(pathfinding_t *finder, const pathfinding_obstacle_t *old)
+{
+  if(!finder->blocked_valid) {
+    pathfinding_update_obstacles(finder);
+    return;
+  }
+  update_obstacle_area(finder, old, true);
+  finder->epoch++;
+}
+
+
+/** @brief Binary min-heap of node indexes
+ *
+ * Order is defined by the \e less callback. Position of each node in the
+ * heap is maintained in \e positions, allowing to update or remove any node.
+ * Position of nodes not in the heap is PATHFINDING_INDEX_NONE.
+ *
+ * If \e positions is NULL, positions are searched in the heap items instead,
+ * which saves memory when updates are rare.
+ */
+typedef struct {
+  /// Return true if node \e a must be popped before node \e b
+  bool (*less)(const void *data, pathfinding_index_t a, pathfinding_index_t b);
+  /// Data passed to \e less
+  const void *data;
+  /// Heap items
+  pathfinding_index_t *items;
+  /// Position in heap of each node, or NULL
+  pathfinding_index_t *positions;
+  /// Number of items in the heap
+  pathfinding_index_t size;
+} node_heap_t;
+
+/// Set a heap item, update node's position
+static void node_heap_set(node_heap_t *heap, pathfinding_index_t pos, pathfinding_index_t node)
+{
+  heap->items[pos] = node;
+  if(heap->positions) {
+    heap->positions[node] = pos;
+  }
+}
+
+/// Return the position of a node in the heap
+static pathfinding_index_t node_heap_position(const node_heap_t *heap, pathfinding_index_t node)
+{
+  if(heap->positions) {
+    return heap->positions[node];
+  }
+  pathfinding_index_t pos = 0;
+  while(heap->items[pos] != node) {
+    pos++;
+  }
+  return pos;
+}
+
+/// Move up an item whose key decreased, return its new position
+static pathfinding_index_t node_heap_sift_up(node_heap_t *heap, pathfinding_index_t pos)
+{
+  const pathfinding_index_t node = heap->items[pos];
+  while(pos > 0) {
+    const pathfinding_index_t parent = (pos - 1) / 2;
+    if(!heap->less(heap->data, node, heap->items[parent])) {
+      break;
+    }
+    node_heap_set(heap, pos, heap->items[parent]);
+    pos = parent;
+  }
+  node_heap_set(heap, pos, node);
+  return pos;
+}
+
+/// Move down an item whose key increased
+static void node_heap_sift_down(node_heap_t *heap, pathfinding_index_t pos)
+{
+  const pathfinding_index_t node = heap->items[pos];
+  // stop before computing child index, to avoid overflows
+  while(pos < heap->size / 2) {
+    pathfinding_index_t child = 2 * pos + 1;
+    if(child + 1 < heap->size && heap->less(heap->data, heap->items[child+1], heap->items[child])) {
+      child++;
+    }
+    if(!heap->less(heap->data, heap->items[child], node)) {
+      break;
+    }
+    node_heap_set(heap, pos, heap->items[child]);
+    pos = child;
+  }
+  node_heap_set(heap, pos, node);
+}
+
+/// Add a node to the heap
+static void node_heap_push(node_heap_t *heap, pathfinding_index_t node)
+{
+  heap->items[heap->size] = node;
+  node_heap_sift_up(heap, heap->size++);
+}
+
+/// Remove the node at a given position from the heap
+static void node_heap_remove_at(node_heap_t *heap, pathfinding_index_t pos)
+{
+  if(heap->positions) {
+    heap->positions[heap->items[pos]] = PATHFINDING_INDEX_NONE;
+  }
+  if(pos != --heap->size) {
+    node_heap_set(heap, pos, heap->items[heap->size]);
+    node_heap_sift_down(heap, node_heap_sift_up(heap, pos));
+  }
+}
+
+/// Remove a node from the heap
+static void node_heap_remove(node_heap_t *heap, pathfinding_index_t node)
+{
+  node_heap_remove_at(heap, node_heap_position(heap, node));
+}
+
+/// Update position of a node whose key decreased
+static void node_heap_decrease(node_heap_t *heap, pathfinding_index_t node)
+{
+  node_heap_sift_up(heap, node_heap_position(heap, node));
+}
+
+/// Update position of a node whose key changed
+static void node_heap_update(node_heap_t *heap, pathfinding_index_t node)
+{
+  node_heap_sift_down(heap, node_heap_sift_up(heap, node_heap_position(heap, node)));
+}
+
+/// Return the node with the lowest key, PATHFINDING_INDEX_NONE if empty
+static pathfinding_index_t node_heap_top(const node_heap_t *heap)
+{
+  return heap->size == 0 ? PATHFINDING_INDEX_NONE : heap->items[0];
+}
+
+/// Remove and return the node with the lowest key, PATHFINDING_INDEX_NONE if empty
+static pathfinding_index_t node_heap_pop(node_heap_t *heap)
+{
+  const pathfinding_index_t node = node_heap_top(heap);
+  if(node != PATHFINDING_INDEX_NONE) {
+    node_heap_remove_at(heap, 0);
+  }
+  return node;
+}
+
+
+#if PATHFINDING_RESERVATIONS
+
+/// Return the reservation slot of a time, in cost units
+static uint8_t reservation_slot(const pathfinding_t *finder, uint32_t time)
+{
+  const uint32_t slot = time / finder->slot_length;
+  return slot < PATHFINDING_SLOT_FOREVER ? slot : PATHFINDING_SLOT_FOREVER - 1;
+}
+
+/// Return a reservation of a node overlapping given slots, NULL if none
+static const pathfinding_reservation_t *reservation_find(const pathfinding_t *finder, pathfinding_index_t node,
+                                                         uint8_t begin, uint8_t end)
+{
+  for(uint8_t i=0; i<finder->reservations_size; i++) {
+    const pathfinding_reservation_t *reservation = &finder->reservations[i];
+    if(reservation->node == node && reservation->begin <= end && reservation->end >= begin) {
+      return reservation;
+    }
+  }
+  return NULL;
+}
+
+/** @brief Return the earliest arrival time on a node, avoiding reservations
+ *
+ * Robot waits on \e node until \e next is free during the whole move. Current
+ * node is occupied until arrival. A goal node must remain free after arrival.
+ *
+ * @return Arrival time, PATHFINDING_COST_MAX if reservations cannot be avoided.
+ */
+static uint32_t reservation_arrival(const pathfinding_t *finder, pathfinding_index_t node, pathfinding_index_t next,
+                                    uint32_t time, uint16_t cost, bool goal)
+{
+  uint32_t departure = time;
+  for(;;) {
+    const uint8_t begin = reservation_slot(finder, departure);
+    const uint8_t end = goal ? PATHFINDING_SLOT_FOREVER : reservation_slot(finder, departure + cost);
+    const pathfinding_reservation_t *reservation = reservation_find(finder, next, begin, end);
+    if(!reservation) {
+      break;
+    }
+    if(reservation->end >= PATHFINDING_SLOT_FOREVER - 1) {
+      return PATHFINDING_COST_MAX;
+    }
+    // wait for the end of the reservation
+    departure = (uint32_t)(reservation->end + 1) * finder->slot_length;
+  }
+  // current node must be free while waiting and moving
+  if(reservation_find(finder, node, reservation_slot(finder, time), reservation_slot(finder, departure + cost))) {
+    return PATHFINDING_COST_MAX;
+  }
+  return departure + cost;
+}
+
+#endif
+
+
+/// A* node states
+enum { PENDING, OPEN, CLOSED };
+
+/// A* cost of nodes not reached yet
+#define ASTAR_COST_NONE  UINT16_MAX
+
+/// A* node costs: total cost of open nodes, cost from start of closed nodes
+#define ASTAR_COSTS(finder)  ((finder)->workspace)
+/// Best previous node of A* nodes
+#define ASTAR_PREVIOUS(finder)  ((pathfinding_index_t *)(ASTAR_COSTS(finder) + (finder)->nodes_size + 1))
+/// A* open set items
+#define ASTAR_OPEN_SET(finder)  (ASTAR_PREVIOUS(finder) + (finder)->nodes_size + 1)
+/// A* open set size
+#define ASTAR_OPEN_SET_SIZE(finder)  (ASTAR_OPEN_SET(finder)[(finder)->nodes_size + 1])
+/// A* node states, packed on 2 bits
+#define ASTAR_STATES(finder)  ((uint8_t *)(&ASTAR_OPEN_SET_SIZE(finder) + 1))
+
+/// Return the state of an A* node
+static uint8_t astar_get(const pathfinding_t *finder, pathfinding_index_t index)
+{
+  return (ASTAR_STATES(finder)[index/4] >> ((index%4)*2)) & 0x03;
+}
+
+/// Set the state of an A* node
+static void astar_set(pathfinding_t *finder, pathfinding_index_t index, uint8_t state)
+{
+  const uint8_t shift = (index%4)*2;
+  uint8_t *p = &ASTAR_STATES(finder)[index/4];
+  *p = (*p & ~(0x03 << shift)) | (state << shift);
+}
+
+/** @brief Return the A* heuristic cost between a node and the goal
+ *
+ * Landmark bounds are computed from graph distances, which may be longer
+ * than any-angle paths. Only the vertex cost is used in any-angle mode.
+ */
+static uint32_t astar_goal_heuristic(const pathfinding_t *finder, pathfinding_index_t index, pathfinding_index_t goal)
+{
+  if(goal == finder->nodes_size) {
+    return vertex_heuristic(&finder->nodes[index], &finder->goal_position);
+  } else if(finder->any_angle) {
+    return FINDER_VERTEX_HEURISTIC(finder, index, goal);
+  }
+  return finder_heuristic(finder, index, goal);
+}
+
+/** @brief Return the A* heuristic cost between a node and the goals
+ *
+ * For multiple goals, the lowest cost is used, unless \e goals_dijkstra is
+ * set. The heuristic of the goal position is 0.
+ */
+static uint32_t astar_heuristic(const pathfinding_t *finder, pathfinding_index_t index)
+{
+  if(index == finder->nodes_size) {
+    return 0;
+  } else if(finder->goal != PATHFINDING_INDEX_NONE) {
+    return astar_goal_heuristic(finder, index, finder->goal);
+  } else if(finder->goals_dijkstra) {
+    return 0;
+  }
+  uint32_t h = PATHFINDING_COST_MAX;
+  for(uint8_t i=0; i<finder->goals_size; i++) {
+    const uint32_t hi = astar_goal_heuristic(finder, index, finder->goals[i]);
+    if(hi < h) {
+      h = hi;
+    }
+  }
+  return h;
+}
+
+/// Return true if a node is a goal of the A* search in progress
+static bool astar_is_goal(const pathfinding_t *finder, pathfinding_index_t index)
+{
+  if(finder->goal != PATHFINDING_INDEX_NONE) {
+    return index == finder->goal;
+  }
+  for(uint8_t i=0; i<finder->goals_size; i++) {
+    if(finder->goals[i] == index) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Return true if a node is linked to the goal position of the A* search in progress
+static bool astar_goal_linked(const pathfinding_t *finder, pathfinding_index_t index)
+{
+  if(finder->goal != finder->nodes_size) {
+    return false;
+  }
+  const pathfinding_node_t *node = &finder->nodes[index];
+  return vertex_cost(&finder->goal_position, node) <= finder->goal_radius &&
+      !vertex_blocked(finder, &finder->goal_position, node);
+}
+
+/** @brief Order A* nodes in open set
+ *
+ * Nodes are ordered by total cost, equal costs are ordered by node index.
+ */
+static bool astar_heap_less(const void *data, pathfinding_index_t a, pathfinding_index_t b)
+{
+  const uint16_t *costs = data;
+  const uint16_t ca = costs[a];
+  const uint16_t cb = costs[b];
+  return ca < cb || (ca == cb && a < b);
+}
+
+/** @brief Return the open set of an A* search
+ *
+ * Open set positions are not stored, they are searched on updates.
+ */
+static node_heap_t astar_open_set(pathfinding_t *finder)
+{
+  node_heap_t open_set = {
+    .less = astar_heap_less,
+    .data = ASTAR_COSTS(finder),
+    .items = ASTAR_OPEN_SET(finder),
+    .positions = NULL,
+    .size = ASTAR_OPEN_SET_SIZE(finder),
+  };
+  return open_set;
+}
+
+/** @brief Initialize an A* search
+ *
+ * The goal position node, at index \e nodes_size, is initialized too.
+ */
+static void astar_init(pathfinding_t *finder, pathfinding_workspace_t *workspace, pathfinding_index_t goal)
+{
+  finder->workspace = workspace;
+  finder->goal = goal;
+  finder->goals_dijkstra = false;
+  finder->path_size = 0;
+  finder->path_cost = PATHFINDING_COST_MAX;
+  finder->path_direct = false;
+  finder->status = PATHFINDING_IN_PROGRESS;
+  FINDER_STATS_INC(finder, searches);
+
+  memset(ASTAR_STATES(finder), 0, (finder->nodes_size+4)/4);  // PENDING
+  uint16_t *costs = ASTAR_COSTS(finder);
+  for(pathfinding_index_t i=0; i<=finder->nodes_size; i++) {
+    costs[i] = ASTAR_COST_NONE;
+  }
+  ASTAR_OPEN_SET_SIZE(finder) = 0;
+}
 
-    astar_nodes[current].state = CLOSED;
-    for(uint8_t i=0; i<finder->nodes[current].neighbors_size; i++) {
-      uint8_t neighbor = finder->nodes[current].neighbors[i];
-      uint8_t state = astar_nodes[neighbor].state;
-      if(state == PENDING) {
-        if(FINDER_NODE_BLOCKED(finder, neighbor)) {
-          astar_nodes[neighbor].state = CLOSED;
+/// Add a starting node to the A* open set
+static void astar_open_start(pathfinding_t *finder, node_heap_t *open_set, pathfinding_index_t index, uint32_t cost)
+{
+  const uint32_t total_cost = cost + astar_heuristic(finder, index);
+  if(total_cost >= ASTAR_COST_NONE) {
+    return;
+  }
+  astar_set(finder, index, OPEN);
+  ASTAR_PREVIOUS(finder)[index] = PATHFINDING_INDEX_NONE;
+  ASTAR_COSTS(finder)[index] = total_cost;
+  node_heap_push(open_set, index);
+}
+
+/// Open the start position: add nodes in line of sight, in a radius, to the A* open set
+static void astar_link_start(pathfinding_t *finder, node_heap_t *open_set,
+                             const pathfinding_node_t *position, uint16_t radius)
+{
+  // range of nodes to check: nodes in grid cells overlapping the radius, or
+  // all nodes if there is no grid
+  const pathfinding_grid_t *grid = finder->grid;
+  grid_range_t range = { 0, 0, 0, 0 };
+  if(grid && !grid_range(grid, (int32_t)position->x - radius, (int32_t)position->y - radius,
+                         (int32_t)position->x + radius, (int32_t)position->y + radius, &range)) {
+    return;
+  }
+
+  for(uint8_t row=range.row0; row<=range.row1; row++) {
+    for(uint8_t column=range.column0; column<=range.column1; column++) {
+      uint16_t k0 = 0, k1 = finder->nodes_size;
+      if(grid) {
+        const uint16_t cell = row * grid->columns + column;
+        k0 = GRID_OFFSET(grid, cell);
+        k1 = GRID_OFFSET(grid, cell+1);
+      }
+      for(uint16_t k=k0; k<k1; k++) {
+        const pathfinding_index_t index = grid ? GRID_NODE(grid, k) : k;
+        const pathfinding_node_t *node = &finder->nodes[index];
+        if(FINDER_NODE_BLOCKED(finder, index)) {
           continue;
         }
-      } else if(state == CLOSED) {
+        const uint32_t cost = vertex_cost(position, node);
+        if(cost > radius || vertex_blocked(finder, position, node)) {
+          continue;
+        }
+        astar_open_start(finder, open_set, index, cost);
+      }
+    }
+  }
+}
+
+/** @brief Reach an A* node from a closed node, with a given cost from start
+ *
+ * Total cost is stored, a node already open is updated if it is lower.
+ */
+static void astar_reach(pathfinding_t *finder, node_heap_t *open_set, pathfinding_index_t index,
+                        pathfinding_index_t origin, uint32_t cost, uint8_t state)
+{
+  uint16_t *costs = ASTAR_COSTS(finder);
+  const uint32_t total_cost = cost + astar_heuristic(finder, index);
+  if(total_cost >= costs[index]) {
+    return;  // also rejects total costs out of range
+  }
+  ASTAR_PREVIOUS(finder)[index] = origin;
+  costs[index] = total_cost;
+  if(state == PENDING) {
+    astar_set(finder, index, OPEN);
+    node_heap_push(open_set, index);
+  } else {
+    node_heap_decrease(open_set, index);
+  }
+}
+
+/** @brief Close an A* node removed from the open set
+ *
+ * Its heuristic is deduced from its cost, which is then the cost from start.
+ */
+static void astar_close(pathfinding_t *finder, pathfinding_index_t index)
+{
+  astar_set(finder, index, CLOSED);
+  ASTAR_COSTS(finder)[index] -= astar_heuristic(finder, index);
+}
+
+/// Expand a closed A* node, relax its neighbors
+static void astar_expand(pathfinding_t *finder, node_heap_t *open_set, pathfinding_index_t current)
+{
+  const uint16_t *costs = ASTAR_COSTS(finder);
+  const uint32_t current_cost = costs[current];
+
+  if(astar_goal_linked(finder, current)) {
+    const pathfinding_index_t goal = finder->nodes_size;
+    const uint32_t cost = current_cost + vertex_cost(&finder->nodes[current], &finder->goal_position);
+    astar_reach(finder, open_set, goal, current, cost, astar_get(finder, goal));
+  }
+
+  for(uint16_t i=FINDER_OFFSET(finder, current), end=FINDER_OFFSET(finder, current+1); i<end; i++) {
+    pathfinding_index_t neighbor = FINDER_NEIGHBOR(finder, i);
+    const uint8_t state = astar_get(finder, neighbor);
+    if(state == PENDING) {
+      // consider blocked nodes as already visited
+      if(FINDER_NODE_BLOCKED(finder, neighbor)) {
+        astar_set(finder, neighbor, CLOSED);
         continue;
       }
-      if(FINDER_VERTEX_BLOCKED(finder, current, neighbor)) {
+    } else if(state == CLOSED) {
+      continue;
+    }
+    if(FINDER_VERTEX_BLOCKED(finder, i)) {
+      continue;
+    }
+
+    pathfinding_index_t origin = current;
+    uint32_t cost = current_cost + FINDER_COST(finder, i);
+#if PATHFINDING_RESERVATIONS
+    if(finder->reservations_size) {
+      // any-angle mode is ignored
+      cost = reservation_arrival(finder, current, neighbor, current_cost,
+                                 FINDER_COST(finder, i), astar_is_goal(finder, neighbor));
+      if(cost == PATHFINDING_COST_MAX) {
         continue;
       }
+    } else
+#endif
+    if(finder->any_angle) {
+      // link directly to the previous node if it is in line of sight
+      // previous node is closed: its cost is the cost from start
+      const pathfinding_index_t previous = ASTAR_PREVIOUS(finder)[current];
+      if(previous != PATHFINDING_INDEX_NONE &&
+         !vertex_blocked(finder, &finder->nodes[previous], &finder->nodes[neighbor])) {
+        origin = previous;
+        cost = costs[previous] + FINDER_VERTEX_COST(finder, previous, neighbor);
+      }
+    }
+    astar_reach(finder, open_set, neighbor, origin, cost, state);
+  }
+}
+
+/** @brief Rebuild the path to a reached A* goal
+ *
+ * Path nodes are closed, their costs are costs from start.
+ *
+ * @return true on success, false if the path is too long
+ */
+static bool astar_build_path(pathfinding_t *finder, pathfinding_index_t current)
+{
+  const pathfinding_index_t *previous = ASTAR_PREVIOUS(finder);
+  const uint32_t cost = ASTAR_COSTS(finder)[current];
+  // goal position is not part of the path
+  if(current == finder->nodes_size) {
+    current = previous[current];
+  }
+  // re build path: get size, then fill values
+  pathfinding_index_t path_size = 1;  // +1 for starting node
+  for(pathfinding_index_t i=current; previous[i]!=PATHFINDING_INDEX_NONE; i=previous[i]) {
+    path_size++;
+  }
+  if(path_size > PATHFINDING_MAX_PATH_SIZE) {
+    return false;
+  }
+  finder->path_size = path_size;
+  finder->path_cost = cost;
+  for(pathfinding_index_t i=current; path_size>0; i=previous[i]) {
+    finder->path[--path_size] = i;
+#if PATHFINDING_RESERVATIONS
+    finder->path_times[path_size] = ASTAR_COSTS(finder)[i];
+#endif
+  }
+  return true;
+}
+
+/** @brief Complete an A* search, release its workspace
+ *
+ * Results of node-to-node searches are stored in the cache.
+ */
+static pathfinding_status_t astar_complete(pathfinding_t *finder, pathfinding_status_t status)
+{
+  if(status != PATHFINDING_FOUND) {
+    finder->path_size = 0;
+    finder->path_cost = PATHFINDING_COST_MAX;
+  }
+  finder->workspace = NULL;
+  finder->status = status;
+#if PATHFINDING_CACHE_SIZE
+#if PATHFINDING_RESERVATIONS
+  if(finder->reservations_size) {
+    return status;
+  }
+#endif
+  if(finder->goal < finder->nodes_size) {
+    cache_store(finder);
+  }
+#endif
+  return status;
+}
+
+
+#if PATHFINDING_STATIC_WORKSPACE
+/// Workspace shared by blocking searches
+static pathfinding_workspace_t static_workspace[PATHFINDING_WORKSPACE_SIZE(PATHFINDING_MAX_NODES_SIZE)];
+/// Declare the workspace of a blocking search, sized for the largest graph
+# define SEARCH_WORKSPACE(name)  pathfinding_workspace_t *const name = static_workspace
+#else
+# define SEARCH_WORKSPACE(name)  pathfinding_workspace_t name[PATHFINDING_WORKSPACE_SIZE(PATHFINDING_MAX_NODES_SIZE)]
+#endif
+
+void pathfinding_search(pathfinding_t *finder, pathfinding_index_t start, pathfinding_index_t goal)
+{
+  SEARCH_WORKSPACE(workspace);
+  pathfinding_start(finder, workspace, start, goal);
+  pathfinding_step(finder, 0);
+}
+
+pathfinding_status_t pathfinding_search_xy(pathfinding_t *finder,
+                                           int16_t start_x, int16_t start_y, int16_t goal_x, int16_t goal_y,
+                                           uint16_t radius)
+{
+  SEARCH_WORKSPACE(workspace);
+  pathfinding_start_xy(finder, workspace, start_x, start_y, goal_x, goal_y, radius);
+  return pathfinding_step(finder, 0);
+}
+
+void pathfinding_start_goals(pathfinding_t *finder, pathfinding_workspace_t *workspace, pathfinding_index_t start,
+                             const pathfinding_index_t *goals, uint8_t goals_size)
+{
+  finder_check_obstacles(finder);
+  astar_init(finder, workspace, PATHFINDING_INDEX_NONE);
+  finder->goals = goals;
+  finder->goals_size = goals_size;
+
+  // start node must not be blocked
+  if(goals_size == 0 || FINDER_NODE_BLOCKED(finder, start)) {
+    pathfinding_cancel(finder);
+    return;
+  }
+
+  node_heap_t open_set = astar_open_set(finder);
+  astar_open_start(finder, &open_set, start, 0);
+  ASTAR_OPEN_SET_SIZE(finder) = open_set.size;
+}
+
+pathfinding_index_t pathfinding_search_goals(pathfinding_t *finder, pathfinding_index_t start,
+                                             const pathfinding_index_t *goals, uint8_t goals_size)
+{
+  SEARCH_WORKSPACE(workspace);
+  pathfinding_start_goals(finder, workspace, start, goals, goals_size);
+  if(pathfinding_step(finder, 0) != PATHFINDING_FOUND) {
+    return PATHFINDING_INDEX_NONE;
+  }
+  return finder->path[finder->path_size-1];
+}
+
+uint8_t pathfinding_goals_costs(pathfinding_t *finder, pathfinding_index_t start,
+                                const pathfinding_index_t *goals, uint8_t goals_size, uint32_t *costs)
+{
+  for(uint8_t i=0; i<goals_size; i++) {
+    costs[i] = PATHFINDING_COST_MAX;
+  }
+
+  // Dijkstra search: goals are reached in cost order, until all of them are
+  // reached; a min-over-goals heuristic would be weak once the nearest goals
+  // are reached, and costly to compute
+  SEARCH_WORKSPACE(workspace);
+  finder_check_obstacles(finder);
+  astar_init(finder, workspace, PATHFINDING_INDEX_NONE);
+  finder->goals = goals;
+  finder->goals_size = goals_size;
+  finder->goals_dijkstra = true;
+  if(goals_size == 0 || FINDER_NODE_BLOCKED(finder, start)) {
+    pathfinding_cancel(finder);
+    return 0;
+  }
+
+  node_heap_t open_set = astar_open_set(finder);
+  astar_open_start(finder, &open_set, start, 0);
+  uint8_t reached = 0;
+  for(;;) {
+    const pathfinding_index_t current = node_heap_pop(&open_set);
+    if(current == PATHFINDING_INDEX_NONE) {
+      break;
+    }
+    FINDER_STATS_INC(finder, expansions);
+    astar_close(finder, current);
+    for(uint8_t i=0; i<goals_size; i++) {
+      if(goals[i] == current) {
+        costs[i] = ASTAR_COSTS(finder)[current];
+        reached++;
+      }
+    }
+    if(reached == goals_size) {
+      break;
+    }
+    astar_expand(finder, &open_set, current);
+  }
+
+  pathfinding_cancel(finder);
+  return reached;
+}
+
+void pathfinding_cancel(pathfinding_t *finder)
+{
+  finder->workspace = NULL;
+  finder->path_size = 0;
+  finder->path_cost = PATHFINDING_COST_MAX;
+  finder->path_direct = false;
+  finder->status = PATHFINDING_FAILED;
+}
+
+void pathfinding_start(pathfinding_t *finder, pathfinding_workspace_t *workspace, pathfinding_index_t start, pathfinding_index_t goal)
+{
+  finder_check_obstacles(finder);
+#if PATHFINDING_CACHE_SIZE
+  pathfinding_cache_entry_t *entry = cache_find(finder, start, goal);
+  if(entry) {
+    FINDER_STATS_INC(finder, cache_hits);
+    cache_touch(finder, entry);
+    finder->workspace = NULL;
+    finder->goal = goal;
+    finder->start = start;
+    finder->path_size = entry->path_size;
+    finder->path_cost = entry->cost;
+    finder->path_direct = false;
+    memcpy(finder->path, entry->path, entry->path_size * sizeof(*entry->path));
+#if PATHFINDING_RESERVATIONS
+    memcpy(finder->path_times, entry->path_times, entry->path_size * sizeof(*entry->path_times));
+#endif
+    // failed searches are cached too
+    finder->status = entry->path_size ? PATHFINDING_FOUND : PATHFINDING_FAILED;
+    return;
+  }
+#endif
+
+  astar_init(finder, workspace, goal);
+  finder->start = start;
+
+  // start node must not be blocked
+  if(FINDER_NODE_BLOCKED(finder, start)) {
+    pathfinding_cancel(finder);
+    return;
+  }
+
+  node_heap_t open_set = astar_open_set(finder);
+  astar_open_start(finder, &open_set, start, 0);
+  ASTAR_OPEN_SET_SIZE(finder) = open_set.size;
+}
+
+void pathfinding_start_xy(pathfinding_t *finder, pathfinding_workspace_t *workspace,
+                          int16_t start_x, int16_t start_y, int16_t goal_x, int16_t goal_y,
+                          uint16_t radius)
+{
+  const pathfinding_node_t start = { start_x, start_y };
+  finder_check_obstacles(finder);
+  finder->goal_position.x = goal_x;
+  finder->goal_position.y = goal_y;
+  finder->goal_radius = radius;
+  astar_init(finder, workspace, finder->nodes_size);
+
+  // start and goal positions must not be blocked
+  if(node_blocked(finder, &start) || node_blocked(finder, &finder->goal_position)) {
+    pathfinding_cancel(finder);
+    return;
+  }
+  // direct path
+  if(!vertex_blocked(finder, &start, &finder->goal_position)) {
+    finder->path_cost = vertex_cost(&start, &finder->goal_position);
+    finder->path_direct = true;
+    finder->workspace = NULL;
+    finder->status = PATHFINDING_FOUND;
+    return;
+  }
+
+  node_heap_t open_set = astar_open_set(finder);
+  astar_link_start(finder, &open_set, &start, radius);
+  ASTAR_OPEN_SET_SIZE(finder) = open_set.size;
+}
+
+pathfinding_status_t pathfinding_step(pathfinding_t *finder, uint16_t max_expansions)
+{
+  if(finder->status != PATHFINDING_IN_PROGRESS) {
+    return finder->status;
+  }
+
+  node_heap_t open_set = astar_open_set(finder);
+
+  for(uint16_t expansions=0; max_expansions == 0 || expansions < max_expansions; expansions++) {
+    // get node with lowest estimated cost
+    pathfinding_index_t current = node_heap_pop(&open_set);
+
+    if(current == PATHFINDING_INDEX_NONE) {
+      goto fail;
+    }
+    FINDER_STATS_INC(finder, expansions);
+    astar_close(finder, current);
+    if(astar_is_goal(finder, current)) {
+      if(!astar_build_path(finder, current)) {
+        goto fail;
+      }
+      return astar_complete(finder, PATHFINDING_FOUND);
+    }
+    astar_expand(finder, &open_set, current);
+  }
+
+  ASTAR_OPEN_SET_SIZE(finder) = open_set.size;
+  return PATHFINDING_IN_PROGRESS;
+
+fail:
+  return astar_complete(finder, PATHFINDING_FAILED);
+}
+
+void pathfinding_smooth_path(pathfinding_t *finder)
+{
+  if(finder->path_size < 3) {
+    return;
+  }
+  pathfinding_index_t size = 1;
+  pathfinding_index_t last = finder->path_size - 1;
+  pathfinding_index_t i = 0;
+  while(i < last) {
+    // find the farthest node in line of sight, next node always is
+    const pathfinding_node_t *node = &finder->nodes[finder->path[i]];
+    pathfinding_index_t j = last;
+    while(j > i + 1 && vertex_blocked(finder, node, &finder->nodes[finder->path[j]])) {
+      j--;
+    }
+    finder->path[size] = finder->path[j];
+#if PATHFINDING_RESERVATIONS
+    finder->path_times[size] = finder->path_times[j];
+#endif
+    size++;
+    i = j;
+  }
+  finder->path_size = size;
+}
+
+/// Add costs, saturate to PATHFINDING_COST_MAX
+static uint32_t cost_add(uint32_t a, uint32_t b)
+{
+  return a > PATHFINDING_COST_MAX - b ? PATHFINDING_COST_MAX : a + b;
+}
+
+/// Return the cost of a vertex from a given node, using the cache
+static uint32_t finder_edge_cost(const pathfinding_t *finder, pathfinding_index_t index_node, uint16_t index_vertex)
+{
+  if(FINDER_NODE_BLOCKED(finder, index_node) ||
+     FINDER_NODE_BLOCKED(finder, FINDER_NEIGHBOR(finder, index_vertex)) ||
+     FINDER_VERTEX_BLOCKED(finder, index_vertex)) {
+    return PATHFINDING_COST_MAX;
+  }
+  return FINDER_COST(finder, index_vertex);
+}
+
+
+/// Return the secondary key of a D* node
+#define DSTAR_KEY2(dnode)  ((dnode)->g < (dnode)->rhs ? (dnode)->g : (dnode)->rhs)
+
+/** @brief Order D* nodes in the queue
+ *
+ * Nodes are ordered by primary key, then secondary key, then node index.
+ */
+static bool dstar_heap_less(const void *data, pathfinding_index_t a, pathfinding_index_t b)
+{
+  const pathfinding_dstar_node_t *nodes = data;
+  const pathfinding_dstar_node_t *na = &nodes[a];
+  const pathfinding_dstar_node_t *nb = &nodes[b];
+  if(na->key != nb->key) {
+    return na->key < nb->key;
+  }
+  const uint32_t ka = DSTAR_KEY2(na);
+  const uint32_t kb = DSTAR_KEY2(nb);
+  return ka < kb || (ka == kb && a < b);
+}
+
+/// Compute the primary key of a D* node
+static uint32_t dstar_key(const pathfinding_dstar_t *dstar, pathfinding_index_t start, pathfinding_index_t index_node)
+{
+  const pathfinding_dstar_node_t *dnode = &dstar->nodes[index_node];
+  const uint32_t h = finder_heuristic(dstar->finder, start, index_node);
+  return cost_add(cost_add(DSTAR_KEY2(dnode), h), dstar->km);
+}
+
+/// Recompute the lookahead cost of a node from its neighbors
+static void dstar_update_rhs(pathfinding_dstar_t *dstar, pathfinding_index_t index_node)
+{
+  if(index_node == dstar->goal) {
+    return;
+  }
+  const pathfinding_t *finder = dstar->finder;
+  uint32_t rhs = PATHFINDING_COST_MAX;
+  for(uint16_t i=FINDER_OFFSET(finder, index_node), end=FINDER_OFFSET(finder, index_node+1); i<end; i++) {
+    const uint32_t g = dstar->nodes[FINDER_NEIGHBOR(finder, i)].g;
+    const uint32_t cost = cost_add(finder_edge_cost(dstar->finder, index_node, i), g);
+    if(cost < rhs) {
+      rhs = cost;
+    }
+  }
+  dstar->nodes[index_node].rhs = rhs;
+}
+
+/// Update queue state of a node after its costs changed
+static void dstar_update_node(pathfinding_dstar_t *dstar, node_heap_t *queue, pathfinding_index_t start, pathfinding_index_t index_node)
+{
+  pathfinding_dstar_node_t *dnode = &dstar->nodes[index_node];
+  const bool queued = queue->positions[index_node] != PATHFINDING_INDEX_NONE;
+  if(dnode->g != dnode->rhs) {
+    dnode->key = dstar_key(dstar, start, index_node);
+    if(queued) {
+      node_heap_update(queue, index_node);
+    } else {
+      node_heap_push(queue, index_node);
+    }
+  } else if(queued) {
+    node_heap_remove(queue, index_node);
+  }
+}
+
+/// Update lookahead costs of a node and its neighbors
+static void dstar_update_around(pathfinding_dstar_t *dstar, node_heap_t *queue, pathfinding_index_t start, pathfinding_index_t index_node)
+{
+  const pathfinding_t *finder = dstar->finder;
+  for(uint16_t i=FINDER_OFFSET(finder, index_node), end=FINDER_OFFSET(finder, index_node+1); i<end; i++) {
+    dstar_update_rhs(dstar, FINDER_NEIGHBOR(finder, i));
+    dstar_update_node(dstar, queue, start, FINDER_NEIGHBOR(finder, i));
+  }
+}
+
+/** @brief Update nodes whose edge costs changed since the last search
+ *
+ * Blocked nodes and vertices are compared to the ones of the last search.
+ */
+static void dstar_apply_changes(pathfinding_dstar_t *dstar, node_heap_t *queue, pathfinding_index_t start)
+{
+  pathfinding_t *finder = dstar->finder;
+  uint8_t affected[(PATHFINDING_MAX_NODES_SIZE+7)/8] = { 0 };
 
-      astar_nodes[neighbor].state = OPEN;  // may be a no-op
-      uint32_t cost = astar_nodes[current].partial_cost + FINDER_VERTEX_COST(finder, current, neighbor);
-      if(cost < astar_nodes[neighbor].partial_cost) {
-        // better origin path
-        astar_nodes[neighbor].previous = current;
-        astar_nodes[neighbor].partial_cost = cost;
-        astar_nodes[neighbor].total_cost = cost + FINDER_VERTEX_COST(finder, neighbor, goal);
+  for(pathfinding_index_t i=0; i<finder->nodes_size; i++) {
+    if(FINDER_NODE_BLOCKED(finder, i) != BITMAP_GET(dstar->blocked_nodes, i)) {
+      // all edges from and to the node changed
+      BITMAP_SET(affected, i);
+      for(uint16_t index=FINDER_OFFSET(finder, i), end=FINDER_OFFSET(finder, i+1); index<end; index++) {
+        BITMAP_SET(affected, FINDER_NEIGHBOR(finder, index));
+      }
+    } else {
+      for(uint16_t index=FINDER_OFFSET(finder, i), end=FINDER_OFFSET(finder, i+1); index<end; index++) {
+        if(BITMAP_GET(finder->blocked_vertices, index) != BITMAP_GET(dstar->blocked_vertices, index)) {
+          BITMAP_SET(affected, i);
+          break;
+        }
       }
     }
+  }
+  memcpy(dstar->blocked_nodes, finder->blocked_nodes, sizeof(dstar->blocked_nodes));
+  memcpy(dstar->blocked_vertices, finder->blocked_vertices, sizeof(dstar->blocked_vertices));
+  dstar->epoch = finder->epoch;
 
-    astar_nodes[current].state = CLOSED;
+  for(pathfinding_index_t i=0; i<finder->nodes_size; i++) {
+    if(BITMAP_GET(affected, i)) {
+      dstar_update_rhs(dstar, i);
+      dstar_update_node(dstar, queue, start, i);
+    }
   }
+}
+
+void pathfinding_dstar_init(pathfinding_dstar_t *dstar, pathfinding_t *finder, pathfinding_index_t goal)
+{
+  finder_check_obstacles(finder);
+  dstar->finder = finder;
+  dstar->goal = goal;
+  dstar->last_start = PATHFINDING_INDEX_NONE;
+  dstar->km = 0;
+  dstar->epoch = finder->epoch;
+  memcpy(dstar->blocked_nodes, finder->blocked_nodes, sizeof(dstar->blocked_nodes));
+  memcpy(dstar->blocked_vertices, finder->blocked_vertices, sizeof(dstar->blocked_vertices));
+  for(pathfinding_index_t i=0; i<finder->nodes_size; i++) {
+    dstar->nodes[i].g = PATHFINDING_COST_MAX;
+    dstar->nodes[i].rhs = PATHFINDING_COST_MAX;
+    dstar->queue_positions[i] = PATHFINDING_INDEX_NONE;
+  }
+  dstar->nodes[goal].rhs = 0;
+  dstar->queue_size = 0;
+}
+
+void pathfinding_dstar_search(pathfinding_dstar_t *dstar, pathfinding_index_t start)
+{
+  pathfinding_t *finder = dstar->finder;
+  finder_check_obstacles(finder);
+  finder->path_direct = false;
+  const pathfinding_index_t goal = dstar->goal;
+  node_heap_t queue = {
+    .less = dstar_heap_less,
+    .data = dstar->nodes,
+    .items = dstar->queue,
+    .positions = dstar->queue_positions,
+    .size = dstar->queue_size,
+  };
+
+  if(dstar->last_start == PATHFINDING_INDEX_NONE) {
+    dstar->nodes[goal].key = finder_heuristic(finder, start, goal);
+    node_heap_push(&queue, goal);
+  } else {
+    // keys already in the queue stay lower bounds, with respect to the new start
+    dstar->km += finder_heuristic(finder, dstar->last_start, start);
+  }
+  dstar->last_start = start;
+  FINDER_STATS_INC(finder, searches);
+  if(dstar->epoch != finder->epoch) {
+    dstar_apply_changes(dstar, &queue, start);
+  }
+
+  // compute costs until start is consistent
+  pathfinding_dstar_node_t *dstart = &dstar->nodes[start];
+  for(;;) {
+    const pathfinding_index_t current = node_heap_top(&queue);
+    if(current == PATHFINDING_INDEX_NONE) {
+      break;
+    }
+    FINDER_STATS_INC(finder, expansions);
+    pathfinding_dstar_node_t *dnode = &dstar->nodes[current];
+    const uint32_t start_key = dstar_key(dstar, start, start);
+    if(dstart->rhs == dstart->g && (dnode->key > start_key ||
+        (dnode->key == start_key && DSTAR_KEY2(dnode) >= DSTAR_KEY2(dstart)))) {
+      break;
+    }
+    const uint32_t key = dstar_key(dstar, start, current);
+    if(dnode->key < key) {
+      dnode->key = key;
+      node_heap_sift_down(&queue, 0);
+    } else if(dnode->g > dnode->rhs) {
+      dnode->g = dnode->rhs;
+      node_heap_pop(&queue);
+      dstar_update_around(dstar, &queue, start, current);
+    } else {
+      dnode->g = PATHFINDING_COST_MAX;
+      dstar_update_rhs(dstar, current);
+      dstar_update_node(dstar, &queue, start, current);
+      dstar_update_around(dstar, &queue, start, current);
+    }
+  }
+  dstar->queue_size = queue.size;
+
+  // build path, following best neighbors
+  if(FINDER_NODE_BLOCKED(finder, start) || FINDER_NODE_BLOCKED(finder, goal) ||
+     dstart->g == PATHFINDING_COST_MAX) {
+    goto fail;
+  }
+  pathfinding_index_t path_size = 0;
+  pathfinding_index_t current = start;
+  for(;;) {
+    if(path_size == PATHFINDING_MAX_PATH_SIZE) {
+      goto fail;
+    }
+    finder->path[path_size++] = current;
+    if(current == goal) {
+      break;
+    }
+    uint32_t best_cost = PATHFINDING_COST_MAX;
+    pathfinding_index_t best = PATHFINDING_INDEX_NONE;
+    for(uint16_t i=FINDER_OFFSET(finder, current), end=FINDER_OFFSET(finder, current+1); i<end; i++) {
+      const pathfinding_index_t neighbor = FINDER_NEIGHBOR(finder, i);
+      const uint32_t cost = cost_add(finder_edge_cost(finder, current, i), dstar->nodes[neighbor].g);
+      if(cost < best_cost) {
+        best_cost = cost;
+        best = neighbor;
+      }
+    }
+    if(best == PATHFINDING_INDEX_NONE) {
+      goto fail;
+    }
+    current = best;
+  }
+  finder->path_size = path_size;
+  finder->path_cost = dstart->g;
+  return;
 
 fail:
   finder->path_size = 0;
+  finder->path_cost = PATHFINDING_COST_MAX;
   return;
 }
 
-uint8_t pathfinding_nearest_node(const pathfinding_t *finder, int16_t x, int16_t y)
+
+#if PATHFINDING_RESERVATIONS
+
+uint8_t pathfinding_reserve_path(const pathfinding_t *finder, pathfinding_reservation_t *reservations, uint8_t size)
 {
-  uint32_t dmin = 0xffff;
-  uint8_t nearest = 0xff;
-  for(uint8_t i=0; i<finder->nodes_size; i++) {
-    const int16_t sdx = finder->nodes[i].x - x;
-    const int16_t sdy = finder->nodes[i].y - y;
-    const uint32_t dx = sdx > 0 ? sdx : -sdx;
-    const uint32_t dy = sdy > 0 ? sdy : -sdy;
-    uint32_t d = dx*dx + dy*dy;
-    if(d < dmin) {
-      dmin = d;
-      nearest = i;
+  uint8_t n = 0;
+  for(pathfinding_index_t i=0; i<finder->path_size && n<size; i++) {
+    pathfinding_reservation_t *reservation = &reservations[n++];
+    reservation->node = finder->path[i];
+    reservation->begin = reservation_slot(finder, finder->path_times[i]);
+    if(i+1 < finder->path_size) {
+      reservation->end = reservation_slot(finder, finder->path_times[i+1]);
+    } else {
+      reservation->end = PATHFINDING_SLOT_FOREVER;
+    }
+  }
+  return n;
+}
+
+void pathfinding_reservations_shift(pathfinding_reservation_t *reservations, uint8_t *size, uint8_t slots)
+{
+  uint8_t n = 0;
+  for(uint8_t i=0; i<*size; i++) {
+    pathfinding_reservation_t reservation = reservations[i];
+    if(reservation.end != PATHFINDING_SLOT_FOREVER) {
+      if(reservation.end < slots) {
+        continue;  // expired
+      }
+      reservation.end -= slots;
+    }
+    reservation.begin = reservation.begin > slots ? reservation.begin - slots : 0;
+    reservations[n++] = reservation;
+  }
+  *size = n;
+}
+
+#endif
+
+/// Squared distance between a node and a position
+static uint32_t node_distance2(const pathfinding_node_t *node, int16_t x, int16_t y)
+{
+  const int32_t dx = (int32_t)node->x - x;
+  const int32_t dy = (int32_t)node->y - y;
+  return (uint32_t)(dx*dx) + (uint32_t)(dy*dy);
+}
+
+pathfinding_index_t pathfinding_nearest_node(const pathfinding_t *finder, int16_t x, int16_t y)
+{
+  uint32_t dmin = UINT32_MAX;
+  pathfinding_index_t nearest = PATHFINDING_INDEX_NONE;
+  const pathfinding_grid_t *grid = finder->grid;
+  if(!grid) {
+    for(pathfinding_index_t i=0; i<finder->nodes_size; i++) {
+      const uint32_t d = node_distance2(&finder->nodes[i], x, y);
+      if(d < dmin) {
+        dmin = d;
+        nearest = i;
+      }
+    }
+    return nearest;
+  }
+
+  // cell of the position, clamped into the grid
+  const int32_t x0 = (int32_t)x - grid->x;
+  const int32_t y0 = (int32_t)y - grid->y;
+  const int16_t column = x0 < 0 ? 0 : x0 / grid->cell < grid->columns ? x0 / grid->cell : grid->columns - 1;
+  const int16_t row = y0 < 0 ? 0 : y0 / grid->cell < grid->rows ? y0 / grid->cell : grid->rows - 1;
+  // check cells on rings around the position cell, until the remaining cells
+  // are farther than the nearest node found
+  for(int16_t ring=0; ; ring++) {
+    if(ring > 0 && nearest != PATHFINDING_INDEX_NONE) {
+      const uint32_t d = (uint32_t)(ring - 1) * grid->cell;
+      if(d * d > dmin) {
+        break;
+      }
+    }
+    bool in_grid = false;
+    for(int16_t r=row-ring; r<=row+ring; r++) {
+      if(r < 0 || r >= grid->rows) {
+        continue;
+      }
+      // first and last rows of the ring are full, others only have two cells
+      const int16_t step = r == row-ring || r == row+ring ? 1 : 2 * ring;
+      for(int16_t c=column-ring; c<=column+ring; c+=step) {
+        if(c < 0 || c >= grid->columns) {
+          continue;
+        }
+        in_grid = true;
+        const uint16_t cell = r * grid->columns + c;
+        for(uint16_t k=GRID_OFFSET(grid, cell), end=GRID_OFFSET(grid, cell+1); k<end; k++) {
+          const pathfinding_index_t index = GRID_NODE(grid, k);
+          const uint32_t d = node_distance2(&finder->nodes[index], x, y);
+          // on tie, keep the lowest index, like the linear scan
+          if(d < dmin || (d == dmin && index < nearest)) {
+            dmin = d;
+            nearest = index;
+          }
+        }
+      }
+    }
+    if(!in_grid) {
+      break;
     }
   }
   return nearest;
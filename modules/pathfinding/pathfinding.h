@@ -20,6 +20,113 @@
  *   ('beta', 'gamma'),
  * ])
  * \endcode
+ *
+ * Graphs can also be built from a description of the field static obstacles,
+ * using \e add_field_graph(). Nodes are created around obstacles inflated by
+ * the robot radius, and linked when in line of sight. Vertices which cannot
+ * be part of a shortest path are pruned. For instance:
+ * \code{.py}
+ * add_field_graph('field', (3000, 2000), robot_radius=150,
+ *   # polygons: [[(x, y), ...]]
+ *   polygons=[[(1000, 0), (1022, 0), (1022, 600), (1000, 600)]],
+ *   # circles: [(x, y, r)]
+ *   circles=[(1500, 1000, 100)],
+ *   # additional nodes: {name: (x, y)}
+ *   nodes={'start': (250, 1000)},
+ * )
+ * \endcode
+ * Running `pathfinding_graphs.py pathfinding_config.py` prints statistics
+ * of built graphs.
+ *
+ * Graph vertices are stored in flash using a compressed sparse row layout:
+ * offsets, neighbors and costs arrays are in program memory, as well as the
+ * nodes grid tables. Nodes positions are kept in RAM.
+ * Node indexes are stored as pathfinding_index_t, on 8 bits, or on 16 bits
+ * if a graph has 255 nodes or more.
+ * Vertex costs are Euclidean distances rounded up, while the heuristic is
+ * rounded down: it stays consistent, as required by incremental searches.
+ *
+ * Landmarks can be added to graphs to improve the search heuristic, using the
+ * \e landmarks parameter of \e add_graph(). Distances from each landmark to
+ * each node are stored in flash. Landmarks are most efficient on graphs with
+ * walls, for which the Euclidean distance is a poor estimation. Gain is
+ * reported by `pathfinding_graphs.py`.
+ *
+ * Blocked nodes and vertices are cached in the path finder. The cache is
+ * computed by the next search after nodes or obstacles have been set with
+ * pathfinding_set_nodes() or pathfinding_set_obstacles(), or explicitly with
+ * pathfinding_update_obstacles(). Obstacle changes are then applied
+ * incrementally: pathfinding_obstacle_added(), pathfinding_obstacle_moved()
+ * and pathfinding_obstacle_removed() only update nodes and vertices near the
+ * changed obstacle, found using the nodes grid. Obstacles modified in place
+ * must be reported using one of these functions.
+ *
+ * Obstacles are circles, axis-aligned rectangles, segments or convex
+ * polygons. Segments only block vertices crossing them, nodes cannot be
+ * blocked by a segment. Walls and robots can then be described with a single
+ * obstacle instead of a chain of circles. Intersections are computed using
+ * integer cross products only, without division.
+ *
+ * pathfinding_dstar_search() is an incremental alternative to
+ * pathfinding_search(), based on D* Lite. Search is done backward, from a
+ * fixed goal. Node costs are kept between searches, only nodes affected by
+ * obstacle changes are updated and start can move between searches. It is
+ * intended to replan frequently toward the same goal.
+ *
+ * Searches can be split over several calls: pathfinding_start() initializes a
+ * search in a workspace provided by the caller, pathfinding_step() then
+ * expands a limited number of nodes on each call. The workspace only has to be
+ * sized for the graph in use (see PATHFINDING_WORKSPACE_SIZE()).
+ *
+ * Blocking searches (pathfinding_search() and the like) use a workspace on the
+ * stack, sized for the largest configured graph; its size is reported by
+ * `pathfinding_graphs.py`. With
+ * \e set_static_workspace(True) in the configuration, a static workspace is
+ * used instead; blocking searches must then not be run concurrently.
+ *
+ * Results of node-to-node searches can be cached, using
+ * \e set_cache_size() in the configuration. A search with the same start,
+ * goal and obstacle epoch then returns the cached result, including arrival
+ * times. Failed searches are cached too. Least recently used results are
+ * replaced first. The cache is not used by searches with reservations.
+ *
+ * Two robots can plan conflict-free paths on the same graph, using
+ * reservations, enabled by \e set_reservations(True) in the configuration
+ * (path finders then store arrival times on path nodes). A robot publishes the nodes of its path and the time slots
+ * during which it occupies them, using pathfinding_reserve_path(). Searches
+ * of the other robot, with these reservations, avoid reserved nodes: robot
+ * waits on the current node until the next one is free (space-time A*). Goal
+ * must remain free after arrival. Slot length and time origin must be shared
+ * by both robots; pathfinding_reservations_shift() moves the time origin.
+ * Reservations are not used by pathfinding_dstar_search().
+ *
+ * Search statistics (number of searches and expanded nodes) can be counted
+ * in the path finder, using \e set_stats(True) in the configuration. It is
+ * intended to benchmark searches on host and on the robot. Random graphs can
+ * be added for benchmarks using \e add_random_graph(). The host benchmark in
+ * `test/pathfinding` builds this module with HOST_VERSION, checks path costs
+ * against Dijkstra and fails if expansions regress beyond a threshold over
+ * its stored baseline; search times are only compared with `make benchmark`.
+ * `pathfinding_graphs.py -b` runs the same comparison on the Python model of
+ * the search, without timings.
+ *
+ * pathfinding_search_goals() searches the nearest of several goals in a
+ * single pass, pathfinding_goals_costs() gets path costs to all of them, to
+ * rank targets.
+ *
+ * Resulting paths can be shortened with pathfinding_smooth_path(), or
+ * searched in any-angle mode (see pathfinding_t::any_angle). Line of sight
+ * is only checked against obstacles.
+ *
+ * Instead of graph nodes, start and goal can be given as positions, using
+ * pathfinding_start_xy(). Nodes near a position are retrieved using a grid
+ * generated with the graph; cell size can be set using the \e grid_cell
+ * parameter of \e add_graph(). The grid is also used by
+ * pathfinding_nearest_node().
+ *
+ * Nodes and segments are checked against all obstacles, with a bounding box
+ * rejection. Sorting obstacles in the nodes grid at runtime has been measured
+ * slower than these scans, up to 32 obstacles.
  */
 //@{
 /**
@@ -35,45 +142,474 @@
 /// Graph node
 typedef struct {
   int16_t x, y;
-  uint8_t neighbors_size;  ///< Number of neighbors
-  uint8_t const *neighbors;  ///< Neighbor node indexes
 } pathfinding_node_t;
 
-/// Graph obstacle (circular)
+/// Obstacle shapes
+typedef enum {
+  PATHFINDING_OBSTACLE_CIRCLE = 0,  ///< Circle of center (x, y) and radius r
+  PATHFINDING_OBSTACLE_RECTANGLE,  ///< Axis-aligned rectangle of center (x, y) and half size (dx, dy)
+  PATHFINDING_OBSTACLE_SEGMENT,  ///< Segment from (x, y) to (x+dx, y+dy)
+  PATHFINDING_OBSTACLE_POLYGON,  ///< Convex polygon, points relative to (x, y)
+} pathfinding_obstacle_shape_t;
+
+/** @brief Graph obstacle
+ *
+ * Shape is a circle by default. For a polygon, \e points must stay valid and
+ * unchanged while the obstacle is used; move it by changing \e x and \e y.
+ */
 typedef struct {
   int16_t x, y;
-  int16_t r;
+  int16_t r;  ///< Radius of circles
+  uint8_t shape;  ///< Shape, see pathfinding_obstacle_shape_t
+  uint8_t points_size;  ///< Number of polygon points
+  int16_t dx, dy;  ///< Rectangle half size, or segment vector
+  const pathfinding_node_t *points;  ///< Polygon points, in any orientation
 } pathfinding_obstacle_t;
 
+/// Graph landmarks
+typedef struct {
+  uint8_t size;  ///< Number of landmarks
+  /// Distance from each landmark to each node, in program memory
+  const uint16_t *distances;
+} pathfinding_landmarks_t;
+
+typedef struct pathfinding_grid pathfinding_grid_t;
+
+/// Reservation end slot of a node reserved indefinitely
+#define PATHFINDING_SLOT_FOREVER  UINT8_MAX
+
 #include "pathfinding/pathfinding_graphs.h"
 
+/** @brief Graph nodes sorted in a uniform grid
+ *
+ * Cells are ordered by row, then column. Nodes of each cell are stored
+ * contiguously, using an offsets array.
+ */
+struct pathfinding_grid {
+  int16_t x, y;  ///< Position of the first cell
+  uint16_t cell;  ///< Cell size
+  uint8_t columns, rows;  ///< Grid size
+  uint16_t vertex_length;  ///< Length of the longest vertex, rounded up
+  /// Index of the first node of each cell, followed by the node count, in program memory
+  const uint16_t *offsets;
+  /// Nodes, sorted by cell, in program memory
+  const pathfinding_index_t *nodes;
+};
+
+/// Search status
+typedef enum {
+  PATHFINDING_FAILED = 0,
+  PATHFINDING_FOUND,
+  PATHFINDING_IN_PROGRESS,
+} pathfinding_status_t;
+
+/** @brief Element of a path search workspace
+ *
+ * A workspace is an array of PATHFINDING_WORKSPACE_SIZE() elements, sized
+ * for the graph it is used with. It holds, for each node followed by the goal
+ * position (see pathfinding_start_xy()):
+ *  - a 16-bit cost: estimated total cost while the node is open, cost from
+ *    start once it is closed (the heuristic is then subtracted);
+ *  - the best previous node;
+ *  - an open set item;
+ *  - the node state, packed on 2 bits.
+ *
+ * Costs are stored on 16 bits: `pathfinding_graphs.py` rejects graphs whose
+ * worst-case path cost exceeds 65534. Links to positions and waits for
+ * reservations are added at runtime; paths whose estimated cost then exceeds
+ * 65534 are not found.
+ *
+ * Workspace takes 4.25 bytes per node with 8-bit indexes, 6.25 bytes with
+ * 16-bit indexes, instead of 10 and 11 bytes for the former per-node
+ * structure. The heuristic of open nodes is computed again when they are
+ * closed or reached through another node, and the open set position of a
+ * node is searched in the open set when its cost decreases.
+ *
+ * Workspace size is reported by `pathfinding_graphs.py`. It is checked at
+ * compile time if \e set_max_workspace_size() is used in the configuration.
+ */
+typedef uint16_t pathfinding_workspace_t;
+
+/** @brief Number of workspace elements for a graph of \e nodes_size nodes
+ *
+ * Example, for a search on the \e field graph:
+ * @code
+ * static pathfinding_workspace_t workspace[PATHFINDING_WORKSPACE_SIZE(FIELD_NODES_SIZE)];
+ * pathfinding_start(&finder, workspace, start, goal);
+ * @endcode
+ */
+#define PATHFINDING_WORKSPACE_SIZE(nodes_size) \
+  ((2 * ((nodes_size)+1) + (2 * ((nodes_size)+1) + 1) * sizeof(pathfinding_index_t) \
+    + ((nodes_size)+4)/4 + 1) / 2)
+
+#if PATHFINDING_MAX_WORKSPACE_SIZE
+_Static_assert(PATHFINDING_WORKSPACE_SIZE(PATHFINDING_MAX_NODES_SIZE) * sizeof(pathfinding_workspace_t)
+               <= PATHFINDING_MAX_WORKSPACE_SIZE,
+               "pathfinding workspace exceeds configured maximum size");
+#endif
+
+#if PATHFINDING_RESERVATIONS
+/** @brief Node reservation, by another robot
+ *
+ * Time is split into slots of pathfinding_t::slot_length.
+ */
+typedef struct {
+  pathfinding_index_t node;  ///< Reserved node
+  uint8_t begin;  ///< First reserved slot
+  uint8_t end;  ///< Last reserved slot, PATHFINDING_SLOT_FOREVER if never released
+} pathfinding_reservation_t;
+#endif
+
+#if PATHFINDING_CACHE_SIZE
+/// Cached search result
+typedef struct {
+  pathfinding_index_t start;  ///< Start node, PATHFINDING_INDEX_NONE if unused
+  pathfinding_index_t goal;  ///< Goal node
+  uint16_t epoch;  ///< Obstacle epoch of the search
+  bool any_angle;  ///< Any-angle mode of the search
+  uint8_t rank;  ///< Rank in usage order, 0 for the most recently used
+  uint32_t cost;  ///< Path cost
+  pathfinding_index_t path_size;  ///< Path size, 0 if no path found, failed searches are cached too
+  pathfinding_index_t path[PATHFINDING_MAX_PATH_SIZE];  ///< Path
+#if PATHFINDING_RESERVATIONS
+  uint32_t path_times[PATHFINDING_MAX_PATH_SIZE];  ///< Arrival time on each path node
+#endif
+} pathfinding_cache_entry_t;
+#endif
+
+#if PATHFINDING_STATS
+/// Search statistics
+typedef struct {
+  uint32_t searches;  ///< Number of searches, cache hits excluded
+  uint32_t expansions;  ///< Number of expanded nodes
+  uint32_t cache_hits;  ///< Number of searches returned from the cache
+} pathfinding_stats_t;
+#endif
+
 /// Path finder
 typedef struct {
   /// Graph nodes
   const pathfinding_node_t *nodes;
   /// Nodes array size
-  uint8_t nodes_size;
+  pathfinding_index_t nodes_size;
+  /// Index of the first vertex of each node, followed by the vertex count, in program memory
+  const uint16_t *offsets;
+  /// Vertex target nodes, indexed by vertex, in program memory
+  const pathfinding_index_t *neighbors;
+  /// Vertex costs, indexed by vertex, in program memory
+  const uint16_t *costs;
+  /// Landmarks, used to improve the heuristic
+  const pathfinding_landmarks_t *landmarks;
+  /// Nodes grid, used to find nodes near a position
+  const pathfinding_grid_t *grid;
   /// Obstacles, to compute unreachable nodes
   pathfinding_obstacle_t *obstacles;
   /// Obstacles array size
   uint8_t obstacles_size;
+#if PATHFINDING_RESERVATIONS
+  /// Nodes reserved by another robot, avoided by A* searches
+  const pathfinding_reservation_t *reservations;
+  /// Reservations array size, 0 to disable reservations
+  uint8_t reservations_size;
+  /// Duration of reservation slots, in cost units, must not be 0
+  uint16_t slot_length;
+#endif
   /// Result path, include the starting node
-  uint8_t path[PATHFINDING_MAX_PATH_SIZE];
+  pathfinding_index_t path[PATHFINDING_MAX_PATH_SIZE];
   /// Result path size, 0 if no path found
-  uint8_t path_size;
+  pathfinding_index_t path_size;
+  /// Result path cost, UINT32_MAX if no path found
+  uint32_t path_cost;
+  /** @brief True if the result is the direct segment between start and goal positions
+   *
+   * Set by pathfinding_start_xy(), path is then empty.
+   */
+  bool path_direct;
+#if PATHFINDING_RESERVATIONS
+  /** @brief Arrival time on each result path node, in cost units
+   *
+   * Set by A* searches. Arrival time includes waits to avoid reservations.
+   */
+  uint32_t path_times[PATHFINDING_MAX_PATH_SIZE];
+#endif
+  /// Status of the last search
+  pathfinding_status_t status;
+  /// Workspace of the search in progress
+  pathfinding_workspace_t *workspace;
+  /** @brief Goal of the search in progress
+   *
+   * Set to nodes_size for a goal position, PATHFINDING_INDEX_NONE for
+   * multiple goals.
+   */
+  pathfinding_index_t goal;
+  /// Start of the search in progress
+  pathfinding_index_t start;
+  /// Goals of the multi-goal search in progress
+  const pathfinding_index_t *goals;
+  /// Number of goals of the multi-goal search in progress
+  uint8_t goals_size;
+  /// True if the multi-goal search in progress has no heuristic (Dijkstra search)
+  bool goals_dijkstra;
+  /// Goal position of the search in progress
+  pathfinding_node_t goal_position;
+  /// Radius of nodes linked to the goal position of the search in progress
+  uint16_t goal_radius;
+  /** @brief Any-angle search mode
+   *
+   * Path is searched on graph vertices, but nodes are linked to the previous
+   * node of their predecessor when in line of sight (Theta* algorithm).
+   */
+  bool any_angle;
+  /// Obstacle epoch, incremented on each obstacle update
+  uint16_t epoch;
+  /// True if blocked nodes and vertices are up-to-date, cleared when nodes or obstacles are set
+  bool blocked_valid;
+  /// Bitmap of nodes blocked by obstacles
+  uint8_t blocked_nodes[(PATHFINDING_MAX_NODES_SIZE+7)/8];
+  /// Bitmap of vertices blocked by obstacles, indexed per node
+  uint8_t blocked_vertices[(PATHFINDING_MAX_VERTICES_SIZE+7)/8];
+#if PATHFINDING_CACHE_SIZE
+  /// Results of recent searches, cleared by pathfinding_update_obstacles()
+  pathfinding_cache_entry_t cache[PATHFINDING_CACHE_SIZE];
+#endif
+#if PATHFINDING_STATS
+  /// Search statistics, never reset by the module
+  pathfinding_stats_t stats;
+#endif
 } pathfinding_t;
 
 
-/// Find a path
-void pathfinding_search(pathfinding_t *finder, uint8_t start, uint8_t goal);
+/// Node state of an incremental path finder
+typedef struct {
+  uint32_t g;  ///< Cost to the goal
+  uint32_t rhs;  ///< One-step lookahead cost to the goal
+  uint32_t key;  ///< Primary key, when in the queue
+} pathfinding_dstar_node_t;
+
+/** @brief Incremental path finder
+ *
+ * Fields are internal, it must be initialized with pathfinding_dstar_init().
+ */
+typedef struct {
+  /// Path finder used for graph, obstacles and results
+  pathfinding_t *finder;
+  /// Goal node
+  pathfinding_index_t goal;
+  /// Start node of the last search, PATHFINDING_INDEX_NONE before the first search
+  pathfinding_index_t last_start;
+  /// Key modifier, accumulated when start moves
+  uint32_t km;
+  /// Obstacle epoch of the last search
+  uint16_t epoch;
+  /// Blocked nodes of the last search
+  uint8_t blocked_nodes[(PATHFINDING_MAX_NODES_SIZE+7)/8];
+  /// Blocked vertices of the last search
+  uint8_t blocked_vertices[(PATHFINDING_MAX_VERTICES_SIZE+7)/8];
+  /// Node states
+  pathfinding_dstar_node_t nodes[PATHFINDING_MAX_NODES_SIZE];
+  /// Priority queue items
+  pathfinding_index_t queue[PATHFINDING_MAX_NODES_SIZE];
+  /// Position of nodes in the priority queue
+  pathfinding_index_t queue_positions[PATHFINDING_MAX_NODES_SIZE];
+  /// Priority queue size
+  pathfinding_index_t queue_size;
+} pathfinding_dstar_t;
+
 
-/// Find nearest node to given coordinates
-uint8_t pathfinding_nearest_node(const pathfinding_t *finder, int16_t x, int16_t y);
+/** @brief Find a path
+ *
+ * The whole search is done in one call, using a workspace on the stack (or a
+ * static one, see \e set_static_workspace()).
+ */
+void pathfinding_search(pathfinding_t *finder, pathfinding_index_t start, pathfinding_index_t goal);
+
+/** @brief Start a resumable path search
+ *
+ * Search state is stored in \e workspace, which must not be used by another
+ * search until the search completes or is cancelled. It must have at least
+ * PATHFINDING_WORKSPACE_SIZE() elements for the graph set in \e finder.
+ * Starting a new search cancels the search in progress.
+ *
+ * The search is then run with pathfinding_step().
+ */
+void pathfinding_start(pathfinding_t *finder, pathfinding_workspace_t *workspace, pathfinding_index_t start, pathfinding_index_t goal);
+
+/** @brief Run a resumable path search
+ *
+ * @param finder  path finder
+ * @param max_expansions  maximum number of nodes to expand, 0 for no limit
+ *
+ * @return The search status. If the search completed, result path is set in
+ * the path finder and the workspace is released.
+ */
+pathfinding_status_t pathfinding_step(pathfinding_t *finder, uint16_t max_expansions);
+
+/** @brief Start a resumable path search between two positions
+ *
+ * Start and goal positions are linked to graph nodes in line of sight, in a
+ * given radius. Links are only checked against obstacles. Search fails if
+ * start or goal position is blocked.
+ *
+ * Resulting path does not include start and goal positions. If the goal is in
+ * line of sight of the start position, search is immediately successful, the
+ * path is empty and pathfinding_t::path_direct is set.
+ */
+void pathfinding_start_xy(pathfinding_t *finder, pathfinding_workspace_t *workspace,
+                          int16_t start_x, int16_t start_y, int16_t goal_x, int16_t goal_y,
+                          uint16_t radius);
+
+/** @brief Find a path between two positions
+ *
+ * The whole search is done in one call, using a workspace on the stack (or a
+ * static one, see \e set_static_workspace()).
+ * See pathfinding_start_xy() for details.
+ */
+pathfinding_status_t pathfinding_search_xy(pathfinding_t *finder,
+                                           int16_t start_x, int16_t start_y, int16_t goal_x, int16_t goal_y,
+                                           uint16_t radius);
+
+/** @brief Start a resumable path search toward the nearest of several goals
+ *
+ * The search stops on the first reached goal, which is the last node of the
+ * result path. \e goals must remain valid until the search completes.
+ */
+void pathfinding_start_goals(pathfinding_t *finder, pathfinding_workspace_t *workspace, pathfinding_index_t start,
+                             const pathfinding_index_t *goals, uint8_t goals_size);
+
+/** @brief Find a path to the nearest of several goals
+ *
+ * The whole search is done in one call, using a workspace on the stack (or a
+ * static one, see \e set_static_workspace()).
+ * See pathfinding_start_goals() for details.
+ *
+ * @return The reached goal, PATHFINDING_INDEX_NONE if no goal is reachable.
+ */
+pathfinding_index_t pathfinding_search_goals(pathfinding_t *finder, pathfinding_index_t start,
+                                             const pathfinding_index_t *goals, uint8_t goals_size);
+
+/** @brief Compute path costs from a node to several goals
+ *
+ * All goals are searched in a single pass. Result path is not set.
+ *
+ * @param finder  path finder
+ * @param start  start node
+ * @param goals  goal nodes
+ * @param goals_size  number of goals
+ * @param costs  output path cost of each goal, UINT32_MAX if unreachable
+ *
+ * @return The number of reachable goals.
+ */
+uint8_t pathfinding_goals_costs(pathfinding_t *finder, pathfinding_index_t start,
+                                const pathfinding_index_t *goals, uint8_t goals_size, uint32_t *costs);
+
+/// Cancel a resumable path search, release its workspace
+void pathfinding_cancel(pathfinding_t *finder);
+
+/** @brief Remove intermediate path nodes when not needed
+ *
+ * Path nodes are skipped when the direct segment between their neighbors in
+ * the path is not blocked by an obstacle.
+ *
+ * @note Segments are only checked against obstacles. Graph areas which are
+ * not reachable must be defined as obstacles too.
+ *
+ * @note Path cost and arrival times are not updated.
+ */
+void pathfinding_smooth_path(pathfinding_t *finder);
+
+/** @brief Initialize an incremental path finder
+ *
+ * Blocked nodes and vertices of \e finder must be up-to-date. Incremental
+ * finder must be initialized again if graph nodes or goal are changed.
+ */
+void pathfinding_dstar_init(pathfinding_dstar_t *dstar, pathfinding_t *finder, pathfinding_index_t goal);
+
+/** @brief Find a path using an incremental path finder
+ *
+ * Obstacle changes since the previous search are retrieved from the cache of
+ * the path finder. Result is stored in the path finder.
+ */
+void pathfinding_dstar_search(pathfinding_dstar_t *dstar, pathfinding_index_t start);
+
+/** @brief Compute blocked nodes and vertices for all obstacles
+ *
+ * This is done automatically by the next search after
+ * pathfinding_set_nodes() or pathfinding_set_obstacles().
+ * Cached search results are cleared.
+ */
+void pathfinding_update_obstacles(pathfinding_t *finder);
+
+/** @brief Update blocked nodes and vertices after an obstacle has been added
+ *
+ * @param finder  path finder
+ * @param index  index of the new obstacle in the obstacles array
+ */
+void pathfinding_obstacle_added(pathfinding_t *finder, uint8_t index);
+
+/** @brief Update blocked nodes and vertices after an obstacle has been moved
+ *
+ * @param finder  path finder
+ * @param index  index of the moved obstacle in the obstacles array
+ * @param old  previous obstacle value
+ */
+void pathfinding_obstacle_moved(pathfinding_t *finder, uint8_t index, const pathfinding_obstacle_t *old);
+
+/** @brief Update blocked nodes and vertices after an obstacle has been removed
+ *
+ * @param finder  path finder
+ * @param old  removed obstacle value
+ */
+void pathfinding_obstacle_removed(pathfinding_t *finder, const pathfinding_obstacle_t *old);
+
+#if PATHFINDING_RESERVATIONS
+/** @brief Reserve nodes of the result path, for another robot
+ *
+ * Each path node is reserved from its arrival slot to the arrival slot of the
+ * next node. The last node is reserved indefinitely.
+ *
+ * @param finder  path finder, with a search result
+ * @param reservations  output reservations
+ * @param size  size of the reservations array
+ *
+ * @return The number of reservations, less than the path size if the array
+ * is too small.
+ */
+uint8_t pathfinding_reserve_path(const pathfinding_t *finder, pathfinding_reservation_t *reservations, uint8_t size);
+
+/** @brief Move the time origin of reservations
+ *
+ * Reservations are shifted back in time, expired reservations are removed.
+ *
+ * @param reservations  reservations to update
+ * @param size  size of the reservations array, updated
+ * @param slots  number of elapsed slots
+ */
+void pathfinding_reservations_shift(pathfinding_reservation_t *reservations, uint8_t *size, uint8_t slots);
+#endif
+
+/** @brief Find nearest node to given coordinates
+ *
+ * Nodes grid is used to only check cells around the position.
+ */
+pathfinding_index_t pathfinding_nearest_node(const pathfinding_t *finder, int16_t x, int16_t y);
 
 /// Set nodes of a given graph to a pathfinding_t object
 #define pathfinding_set_nodes(finder, name)  do { \
   (finder)->nodes = name ## _nodes; \
   (finder)->nodes_size = sizeof(name ## _nodes) / sizeof(pathfinding_node_t); \
+  (finder)->offsets = name ## _offsets; \
+  (finder)->neighbors = name ## _neighbors; \
+  (finder)->costs = name ## _costs; \
+  (finder)->landmarks = &name ## _landmarks; \
+  (finder)->grid = &name ## _grid; \
+  (finder)->blocked_valid = false; \
+} while(0)
+
+/// Set obstacles of a pathfinding_t object
+#define pathfinding_set_obstacles(finder, array, size)  do { \
+  (finder)->obstacles = (array); \
+  (finder)->obstacles_size = (size); \
+  (finder)->blocked_valid = false; \
 } while(0)
 
 #endif
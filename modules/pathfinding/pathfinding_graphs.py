@@ -1,4 +1,18 @@
 #!/usr/bin/env python3
+import heapq
+import math
+import random
+import time
+try:
+  from math import isqrt
+except ImportError:  # Python < 3.8
+  def isqrt(n):
+    x = int(n ** 0.5)
+    while x * x > n:
+      x -= 1
+    while (x + 1) * (x + 1) <= n:
+      x += 1
+    return x
 
 template_graph_h = """
 enum {
@@ -7,19 +21,64 @@ enum {
 };
 
 extern const pathfinding_node_t %(c_var)s_nodes[%(nodes_count)d];
+extern const uint16_t %(c_var)s_offsets[%(offsets_count)d];
+extern const pathfinding_index_t %(c_var)s_neighbors[%(vertices_count)d];
+extern const uint16_t %(c_var)s_costs[%(vertices_count)d];
+extern const pathfinding_landmarks_t %(c_var)s_landmarks;
+extern const pathfinding_grid_t %(c_var)s_grid;
 
 """
 
 template_graph_c = """
 
-%(c_neighbors)s
-
 const pathfinding_node_t %(c_var)s_nodes[%(nodes_count)d] = {
 %(c_nodes)s
 };
 
+const uint16_t %(c_var)s_offsets[%(offsets_count)d] PROGMEM = {
+%(c_offsets)s
+};
+
+const pathfinding_index_t %(c_var)s_neighbors[%(vertices_count)d] PROGMEM = {
+%(c_neighbors)s
+};
+
+const uint16_t %(c_var)s_costs[%(vertices_count)d] PROGMEM = {
+%(c_costs)s
+};
+
+%(c_landmarks)s
+static const uint16_t %(c_var)s_grid_offsets[%(grid_offsets_count)d] PROGMEM = {
+%(c_grid_offsets)s
+};
+
+static const pathfinding_index_t %(c_var)s_grid_nodes[%(nodes_count)d] PROGMEM = {
+%(c_grid_nodes)s
+};
+
+const pathfinding_grid_t %(c_var)s_grid = {
+  %(grid_x)d, %(grid_y)d, %(grid_cell)d, %(grid_columns)d, %(grid_rows)d, %(grid_vertex_length)d,
+  %(c_var)s_grid_offsets, %(c_var)s_grid_nodes,
+};
 """
 
+template_landmarks_c = """\
+static const uint16_t %(c_var)s_landmarks_distances[%(distances_count)d] PROGMEM = {
+%(c_distances)s
+};
+
+const pathfinding_landmarks_t %(c_var)s_landmarks = {
+  %(landmarks_count)d, %(c_var)s_landmarks_distances,
+};
+"""
+
+template_no_landmarks_c = """\
+const pathfinding_landmarks_t %(c_var)s_landmarks = { 0, NULL };
+"""
+
+# distance to unreachable nodes in landmark tables
+LANDMARK_UNREACHABLE = 0xffff
+
 
 class Node:
   def __init__(self, name, index, x, y, neighbors):
@@ -29,9 +88,24 @@ class Node:
     self.y = y
     self.neighbors = neighbors
 
+  def cost(self, other):
+    """Return vertex cost to another node, as computed by C code
+
+    Costs are rounded up, so that heuristics (rounded down) are consistent.
+    """
+    d2 = (self.x - other.x) ** 2 + (self.y - other.y) ** 2
+    d = isqrt(d2)
+    return d if d * d == d2 else d + 1
+
+  def distance(self, other):
+    """Return distance to another node, rounded down, as computed by C code"""
+    return isqrt((self.x - other.x) ** 2 + (self.y - other.y) ** 2)
+
 class Graph:
-  def __init__(self, name, nodes, vertices):
+  def __init__(self, name, nodes, vertices, landmarks=0, grid_cell=None):
     self.name = name
+    # statistics reported by the generator, if any
+    self.stats = {}
 
     # normalize vertices
     vertices_pairs = []
@@ -53,6 +127,8 @@ class Graph:
       neighbors[a].add(b)
       neighbors[b].add(a)
 
+    if not nodes:
+      raise ValueError("graph %s has no nodes" % self.name)
     self.nodes = []
     for i, (name, (x, y)) in enumerate(sorted(nodes.items())):
       #if name not in neighbors:
@@ -65,6 +141,171 @@ class Graph:
       node.neighbors = [nodes_by_name[name] for name in sorted(node.neighbors)]
     self.vertices = [(nodes_by_name[n1], nodes_by_name[n2]) for n1, n2 in vertices_pairs]
 
+    # index vertices from each node to its neighbors (CSR layout)
+    self.vertices_size = 0
+    for node in self.nodes:
+      node.vertices_index = self.vertices_size
+      self.vertices_size += len(node.neighbors)
+
+    for a, b in self.vertices:
+      if math.ceil(math.hypot(a.x - b.x, a.y - b.y)) > 0xffff:
+        raise ValueError("vertex too long: (%r, %r)" % (a.name, b.name))
+    # vertex offsets are stored on 16 bits
+    if self.vertices_size > 0xffff:
+      raise ValueError("too many vertices in graph %s" % self.name)
+    # search costs are stored on 16 bits, 0xffff is reserved
+    # a path leaves each node at most once: bound its cost with the longest vertex of each node
+    self.max_path_cost = sum(max([node.cost(n) for n in node.neighbors], default=0) for node in self.nodes)
+    if self.max_path_cost >= 0xffff:
+      raise ValueError("worst-case path cost of graph %s overflows search costs: %d" % (self.name, self.max_path_cost))
+
+    if landmarks < 0 or landmarks > len(self.nodes):
+      raise ValueError("invalid landmark count for graph %s" % self.name)
+    self.build_grid(grid_cell)
+
+    self.landmarks = self.select_landmarks(landmarks)
+    # distances are clamped, which keeps the heuristic admissible
+    self.landmarks_distances = [
+      [LANDMARK_UNREACHABLE if d is None else min(d, LANDMARK_UNREACHABLE - 1) for d in self.distances(l)]
+      for l in self.landmarks]
+
+  def build_grid(self, cell):
+    """Sort nodes in a uniform grid, used to find nodes near a position
+
+    If cell size is not provided, it is chosen to have about 2 nodes per cell.
+    """
+    xs = [node.x for node in self.nodes]
+    ys = [node.y for node in self.nodes]
+    self.grid_x, self.grid_y = min(xs), min(ys)
+    width = max(xs) - self.grid_x + 1
+    height = max(ys) - self.grid_y + 1
+    if cell is None:
+      cell = max(1, isqrt(2 * width * height // len(self.nodes)))
+    elif cell <= 0 or cell > 0xffff:
+      raise ValueError("invalid grid cell size for graph %s" % self.name)
+    # grid dimensions are stored on 8 bits
+    cell = max(cell, (width + 254) // 255, (height + 254) // 255)
+    self.grid_cell = cell
+    self.grid_columns = (width + cell - 1) // cell
+    self.grid_rows = (height + cell - 1) // cell
+    self.grid_cells = [[] for _ in range(self.grid_columns * self.grid_rows)]
+    for node in self.nodes:
+      column = (node.x - self.grid_x) // cell
+      row = (node.y - self.grid_y) // cell
+      self.grid_cells[row * self.grid_columns + column].append(node)
+    # used to find vertices near an obstacle
+    self.grid_vertex_length = max([math.ceil(math.hypot(a.x - b.x, a.y - b.y)) for a, b in self.vertices] or [0])
+
+  def distances(self, source):
+    """Return the list of distances from a node, None if unreachable"""
+    result = [None] * len(self.nodes)
+    queue = [(0, source.index)]
+    while queue:
+      d, i = heapq.heappop(queue)
+      if result[i] is not None:
+        continue
+      result[i] = d
+      node = self.nodes[i]
+      for n in node.neighbors:
+        if result[n.index] is None:
+          heapq.heappush(queue, (d + node.cost(n), n.index))
+    return result
+
+  def select_landmarks(self, count):
+    """Select landmarks, spread using farthest-point selection"""
+    landmarks = []
+    if count == 0:
+      return landmarks
+    # start from the node the farthest from the first one
+    nearest = self.distances(self.nodes[0])
+    for _ in range(count):
+      candidates = [(d, -i) for i, d in enumerate(nearest) if d is not None and self.nodes[i] not in landmarks]
+      if not candidates:
+        break
+      landmark = self.nodes[-max(candidates)[1]]
+      landmarks.append(landmark)
+      distances = self.distances(landmark)
+      nearest = [None if a is None or b is None else min(a, b) for a, b in zip(nearest, distances)]
+    return landmarks
+
+  def heuristic(self, a, b, use_landmarks):
+    """Return the heuristic cost between two nodes, as computed by C code"""
+    h = a.distance(b)
+    if use_landmarks:
+      for distances in self.landmarks_distances:
+        da, db = distances[a.index], distances[b.index]
+        if da != LANDMARK_UNREACHABLE and db != LANDMARK_UNREACHABLE:
+          h = max(h, abs(da - db))
+    return h
+
+  def search_expansions(self, start, goal, use_landmarks):
+    """Run A* as done by C code, return the number of expanded nodes"""
+    return self.search(start, goal, use_landmarks)[0]
+
+  def search(self, start, goal, use_landmarks):
+    """Run A* as done by C code
+
+    Return an (expansions, cost) tuple, cost is None if goal is unreachable.
+    """
+    costs = {start.index: 0}
+    queue = [(self.heuristic(start, goal, use_landmarks), start.index)]
+    closed = set()
+    expansions = 0
+    while queue:
+      _, i = heapq.heappop(queue)
+      if i in closed:
+        continue
+      expansions += 1
+      if i == goal.index:
+        return expansions, costs[i]
+      closed.add(i)
+      node = self.nodes[i]
+      for n in node.neighbors:
+        if n.index in closed:
+          continue
+        cost = costs[i] + node.cost(n)
+        if cost < costs.get(n.index, cost + 1):
+          costs[n.index] = cost
+          heapq.heappush(queue, (cost + self.heuristic(n, goal, use_landmarks), n.index))
+    return expansions, None
+
+  def landmarks_report(self, samples=1000):
+    """Compare node expansions without and with landmarks
+
+    Return a (searches, expansions, landmarks_expansions) tuple.
+    Searches are done on random node pairs, without obstacles.
+    """
+    rand = random.Random(0)
+    pairs = [(rand.choice(self.nodes), rand.choice(self.nodes)) for _ in range(samples)]
+    expansions = sum(self.search_expansions(a, b, False) for a, b in pairs)
+    landmarks_expansions = sum(self.search_expansions(a, b, True) for a, b in pairs)
+    return len(pairs), expansions, landmarks_expansions
+
+  def benchmark(self, samples=1000):
+    """Run A* searches on random node pairs, compare them to Dijkstra
+
+    Landmarks are used if the graph has some. Return a dict of results.
+    """
+    rand = random.Random(0)
+    pairs = [(rand.choice(self.nodes), rand.choice(self.nodes)) for _ in range(samples)]
+    expansions = 0
+    suboptimal = 0
+    excess = 0
+    for a, b in pairs:
+      n, cost = self.search(a, b, True)
+      expansions += n
+      reference = self.distances(a)[b.index]
+      if cost != reference:
+        suboptimal += 1
+        excess = max(excess, cost - reference)
+    return {
+      'searches': len(pairs),
+      'expansions per search': expansions / len(pairs),
+      'expansion ratio': expansions / len(pairs) / len(self.nodes),
+      'suboptimal paths': suboptimal,
+      'max excess cost': excess,
+    }
+
   def c_node_enum(self, node):
       return "%s_NODE_%s" % (self.name.upper(), node.name.upper())
 
@@ -72,6 +313,8 @@ class Graph:
     c_var = self.name
     c_VAR = c_var.upper()
     nodes_count = len(self.nodes)
+    offsets_count = nodes_count + 1
+    vertices_count = self.vertices_size
     c_nodes_enum = '\n'.join("  %s," % self.c_node_enum(node) for node in self.nodes)
     return template_graph_h % locals()
 
@@ -79,30 +322,327 @@ class Graph:
     c_var = self.name
     c_VAR = c_var.upper()
     nodes_count = len(self.nodes)
+    offsets_count = nodes_count + 1
+    vertices_count = self.vertices_size
 
-    c_neighbors = '\n'.join("static const uint8_t %s_neighbors_%s[] = {%s};" % (
-      c_var, node.name, ', '.join(self.c_node_enum(n) for n in node.neighbors)
+    c_nodes = '\n'.join(" /* %2d */ [%s] = {%d, %d}," % (
+      node.index, self.c_node_enum(node), node.x, node.y,
     ) for node in self.nodes)
 
-    c_nodes = '\n'.join(" /* %2d */ [%s] = {%d, %d, %d, %s_neighbors_%s}," % (
-      node.index, self.c_node_enum(node), node.x, node.y, len(node.neighbors), c_var, node.name
+    c_offsets = '\n'.join(" /* %2d */ %d," % (
+      node.index, node.vertices_index,
+    ) for node in self.nodes) + "\n %d," % self.vertices_size
+
+    c_neighbors = '\n'.join(" /* %2d */ %s" % (
+      node.index, ''.join("%s, " % self.c_node_enum(n) for n in node.neighbors).rstrip(),
+    ) for node in self.nodes)
+
+    c_costs = '\n'.join(" /* %2d */ %s" % (
+      node.index, ''.join("%d, " % node.cost(n) for n in node.neighbors).rstrip(),
     ) for node in self.nodes)
 
+    if self.landmarks:
+      landmarks_count = len(self.landmarks)
+      distances_count = landmarks_count * nodes_count
+      c_distances = '\n'.join(" /* %s */ %s" % (
+        self.c_node_enum(landmark), ''.join("%d, " % d for d in distances).rstrip(),
+      ) for landmark, distances in zip(self.landmarks, self.landmarks_distances))
+      c_landmarks = template_landmarks_c % locals()
+    else:
+      c_landmarks = template_no_landmarks_c % locals()
+
+    grid_x, grid_y, grid_cell = self.grid_x, self.grid_y, self.grid_cell
+    grid_columns, grid_rows = self.grid_columns, self.grid_rows
+    grid_vertex_length = self.grid_vertex_length
+    grid_offsets_count = len(self.grid_cells) + 1
+    grid_offsets = [0]
+    for nodes in self.grid_cells:
+      grid_offsets.append(grid_offsets[-1] + len(nodes))
+    c_grid_offsets = '\n'.join(" %s" % ''.join("%d, " % offset for offset in grid_offsets[i:i+grid_columns]).rstrip()
+                                for i in range(0, len(grid_offsets), grid_columns))
+    c_grid_nodes = '\n'.join(" /* %d */ %s" % (
+      i, ''.join("%s, " % self.c_node_enum(n) for n in nodes).rstrip(),
+    ) for i, nodes in enumerate(self.grid_cells) if nodes)
+
     return template_graph_c % locals()
 
 
+class FieldBuilder:
+  """
+  Build a visibility graph from a field description
+
+  Field obstacles are inflated by the robot radius. Nodes are placed on the
+  convex corners of inflated polygons and around inflated circles. Then, all
+  pairs of nodes in line of sight are linked, except redundant vertices.
+
+  Attributes:
+    nodes -- nodes, as expected by Graph: {name: (x, y)}
+    vertices -- vertices, as expected by Graph: [(name1, name2)]
+    stats -- build statistics: {name: value}
+
+  """
+
+  def __init__(self, width, height, robot_radius, polygons=(), circles=(),
+               nodes=None, margin=1, circle_sides=8):
+    t0 = time.time()
+    if robot_radius < 0 or margin < 0:
+      raise ValueError("invalid robot radius or margin")
+    if circle_sides < 3:
+      raise ValueError("invalid circle sides count")
+    self.width = width
+    self.height = height
+    self.radius = robot_radius
+    self.margin = margin
+    # inflated circles: [(x, y, r)]
+    self.circles = [(x, y, r + robot_radius) for x, y, r in circles]
+    # obstacle segments, not inflated: [((x1, y1), (x2, y2))]
+    self.polygons = [self.counterclockwise(p) for p in polygons]
+    self.segments = [(p[i-1], p[i]) for p in self.polygons for i in range(len(p))]
+
+    # candidate nodes: [(name, (x, y), (prev, next))]
+    # (prev, next) are the obstacle points around the corner, translated with
+    # the corner, used to prune vertices which are not tangent to the obstacle
+    candidates = []
+    offset = robot_radius + margin
+    for i, polygon in enumerate(self.polygons):
+      for j, point in enumerate(polygon):
+        prev, next_ = polygon[j-1], polygon[(j+1) % len(polygon)]
+        corners = self.inflated_corners(prev, point, next_, offset)
+        for k, corner in enumerate(corners):
+          # neighbors are the adjacent polygon points, or the other bevel corner
+          dx, dy = corner[0] - point[0], corner[1] - point[1]
+          around_prev = corners[0] if k == 1 else (prev[0] + dx, prev[1] + dy)
+          around_next = corners[1] if k == 0 and len(corners) == 2 else (next_[0] + dx, next_[1] + dy)
+          name = "p%d_%d" % (i, j) if len(corners) == 1 else "p%d_%d%s" % (i, j, "ab"[k])
+          candidates.append((name, corner, (around_prev, around_next)))
+    for i, (x, y, r) in enumerate(circles):
+      # regular polygon around the inflated circle
+      d = (r + offset) / math.cos(math.pi / circle_sides)
+      points = [(x + d * math.cos(2 * math.pi * k / circle_sides),
+                 y + d * math.sin(2 * math.pi * k / circle_sides)) for k in range(circle_sides)]
+      for k, point in enumerate(points):
+        candidates.append(("c%d_%d" % (i, k), point, (points[k-1], points[(k+1) % circle_sides])))
+    for name, point in sorted((nodes or {}).items()):
+      if not self.is_free(point):
+        raise ValueError("node %r is not in free space" % name)
+      candidates.append((name, point, None))
+
+    # keep nodes in free space, with integer coordinates
+    self.nodes = {}
+    corners = {}
+    for name, point, around in candidates:
+      point = (int(round(point[0])), int(round(point[1])))
+      if self.is_free(point):
+        self.nodes[name] = point
+        corners[name] = around
+    names = sorted(self.nodes)
+
+    vertices = []
+    visible = 0
+    for i, a in enumerate(names):
+      for b in names[i+1:]:
+        pa, pb = self.nodes[a], self.nodes[b]
+        if not self.is_visible(pa, pb):
+          continue
+        visible += 1
+        if not self.is_tangent(pa, pb, corners[a]) or not self.is_tangent(pb, pa, corners[b]):
+          continue
+        if any(self.is_between(pa, pb, self.nodes[c]) for c in names if c != a and c != b):
+          continue
+        vertices.append((a, b))
+
+    # remove corners without vertices, they are not on any shortest path
+    linked = {name for vertex in vertices for name in vertex}
+    for name in names:
+      if name not in linked and corners[name] is not None:
+        del self.nodes[name]
+    self.vertices = vertices
+
+    self.stats = {
+      'candidate nodes': len(candidates),
+      'visible pairs': visible,
+      'pruned vertices': visible - len(self.vertices),
+      'pruned nodes': len(names) - len(self.nodes),
+      'build time (s)': round(time.time() - t0, 2),
+    }
+
+  @staticmethod
+  def counterclockwise(polygon):
+    polygon = [tuple(p) for p in polygon]
+    if len(polygon) < 3:
+      raise ValueError("polygon with less than 3 points: %r" % (polygon,))
+    area = sum(x1 * y2 - x2 * y1 for (x1, y1), (x2, y2) in zip(polygon, polygon[1:] + polygon[:1]))
+    return polygon if area > 0 else polygon[::-1]
+
+  @staticmethod
+  def inflated_corners(prev, point, next_, offset):
+    """Return the inflated positions of a polygon corner
+
+    Return a single point for obtuse corners, two bevel points for acute
+    corners, and no point for concave corners.
+    """
+    e1 = (point[0] - prev[0], point[1] - prev[1])
+    e2 = (next_[0] - point[0], next_[1] - point[1])
+    if e1[0] * e2[1] - e1[1] * e2[0] <= 0:
+      return []
+    # edge directions and outward normals (polygon is counterclockwise)
+    l1, l2 = math.hypot(*e1), math.hypot(*e2)
+    u1, u2 = (e1[0] / l1, e1[1] / l1), (e2[0] / l2, e2[1] / l2)
+    n1, n2 = (u1[1], -u1[0]), (u2[1], -u2[0])
+    cos = n1[0] * n2[0] + n1[1] * n2[1]
+    if cos >= 0:
+      # intersection of inflated edges
+      k = offset / (1 + cos)
+      return [(point[0] + k * (n1[0] + n2[0]), point[1] + k * (n1[1] + n2[1]))]
+    # intersection would be too far, cut it
+    return [
+      (point[0] + offset * (n1[0] + u1[0]), point[1] + offset * (n1[1] + u1[1])),
+      (point[0] + offset * (n2[0] - u2[0]), point[1] + offset * (n2[1] - u2[1])),
+    ]
+
+  @staticmethod
+  def point_segment_distance(p, a, b):
+    dx, dy = b[0] - a[0], b[1] - a[1]
+    l2 = dx * dx + dy * dy
+    t = 0 if l2 == 0 else max(0, min(1, ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / l2))
+    return math.hypot(a[0] + t * dx - p[0], a[1] + t * dy - p[1])
+
+  @classmethod
+  def segments_distance(cls, a, b, c, d):
+    def orient(p, q, r):
+      return (q[0] - p[0]) * (r[1] - p[1]) - (q[1] - p[1]) * (r[0] - p[0])
+    if (orient(a, b, c) > 0) != (orient(a, b, d) > 0) and (orient(c, d, a) > 0) != (orient(c, d, b) > 0):
+      return 0
+    return min(cls.point_segment_distance(a, c, d), cls.point_segment_distance(b, c, d),
+               cls.point_segment_distance(c, a, b), cls.point_segment_distance(d, a, b))
+
+  @staticmethod
+  def in_polygon(p, polygon):
+    inside = False
+    for (x1, y1), (x2, y2) in zip(polygon, polygon[1:] + polygon[:1]):
+      if (y1 > p[1]) != (y2 > p[1]) and p[0] < x1 + (p[1] - y1) * (x2 - x1) / (y2 - y1):
+        inside = not inside
+    return inside
+
+  def is_free(self, p):
+    """Return True if the robot can be at a given position"""
+    r = self.radius
+    if not (r <= p[0] <= self.width - r and r <= p[1] <= self.height - r):
+      return False
+    if any(math.hypot(p[0] - x, p[1] - y) < cr for x, y, cr in self.circles):
+      return False
+    if any(self.point_segment_distance(p, a, b) < r for a, b in self.segments):
+      return False
+    return not any(self.in_polygon(p, polygon) for polygon in self.polygons)
+
+  def is_visible(self, a, b):
+    """Return True if the robot can move between two free positions
+
+    Field is convex, so free positions are always linked inside the field.
+    """
+    r = self.radius
+    if any(self.point_segment_distance((x, y), a, b) < cr for x, y, cr in self.circles):
+      return False
+    xmin, xmax = min(a[0], b[0]) - r, max(a[0], b[0]) + r
+    ymin, ymax = min(a[1], b[1]) - r, max(a[1], b[1]) + r
+    for c, d in self.segments:
+      if max(c[0], d[0]) < xmin or min(c[0], d[0]) > xmax or max(c[1], d[1]) < ymin or min(c[1], d[1]) > ymax:
+        continue
+      if self.segments_distance(a, b, c, d) < r:
+        return False
+    return True
+
+  def is_tangent(self, a, b, around):
+    """Return True if segment from a corner is tangent to its obstacle
+
+    A vertex which would enter the obstacle around a corner is never part of
+    a shortest path. Nodes not created from a corner are always tangent.
+    Since corners are inflated with a margin, segments entering the obstacle
+    by less than the margin are considered tangent.
+    """
+    if around is None:
+      return True
+    (px, py), (nx, ny) = around
+    dx, dy = b[0] - a[0], b[1] - a[1]
+    tolerance = max(1, self.margin) * math.hypot(dx, dy)
+    side_prev = dx * (py - a[1]) - dy * (px - a[0])
+    side_next = dx * (ny - a[1]) - dy * (nx - a[0])
+    return not ((side_prev < -tolerance and side_next > tolerance) or
+                (side_prev > tolerance and side_next < -tolerance))
+
+  @staticmethod
+  def is_between(a, b, c):
+    """Return True if c is on segment ab, making vertex ab redundant"""
+    ab = math.hypot(b[0] - a[0], b[1] - a[1])
+    return math.hypot(c[0] - a[0], c[1] - a[1]) + math.hypot(b[0] - c[0], b[1] - c[1]) - ab < 1e-6 * ab
+
+
+class RandomBuilder:
+  """
+  Build a random geometric graph, for benchmarks
+
+  Nodes are placed randomly in the field, out of random circular obstacles.
+  Nodes closer than a given radius are linked if the segment between them
+  does not cross an obstacle.
+
+  Attributes:
+    nodes -- nodes, as expected by Graph: {name: (x, y)}
+    vertices -- vertices, as expected by Graph: [(name1, name2)]
+    stats -- build statistics: {name: value}
+
+  """
+
+  def __init__(self, width, height, nodes, radius, obstacles=0, obstacle_radius=150, seed=0):
+    if nodes <= 0 or radius <= 0:
+      raise ValueError("invalid node count or radius")
+    rand = random.Random(seed)
+    circles = [(rand.uniform(0, width), rand.uniform(0, height), obstacle_radius) for _ in range(obstacles)]
+
+    self.nodes = {}
+    while len(self.nodes) < nodes:
+      p = (rand.randrange(width), rand.randrange(height))
+      if all(math.hypot(p[0] - x, p[1] - y) >= r for x, y, r in circles):
+        self.nodes["n%d" % len(self.nodes)] = p
+
+    names = sorted(self.nodes)
+    self.vertices = []
+    for i, a in enumerate(names):
+      for b in names[i+1:]:
+        pa, pb = self.nodes[a], self.nodes[b]
+        if math.hypot(pb[0] - pa[0], pb[1] - pa[1]) > radius:
+          continue
+        if any(FieldBuilder.point_segment_distance((x, y), pa, pb) < r for x, y, r in circles):
+          continue
+        self.vertices.append((a, b))
+
+    self.stats = {
+      'obstacles': obstacles,
+      'isolated nodes': len(set(names) - {name for vertex in self.vertices for name in vertex}),
+    }
+
+
 class CodeGenerator:
   """
   Generate code from a script with graphs
 
   Attribute:
     max_path_size -- maximum result path size
+    cache_size -- number of search results cached in path finders
+    stats -- True to count search statistics in path finders
+    reservations -- True to enable node reservations and path arrival times
+    static_workspace -- True to use a static workspace for blocking searches
+    max_workspace_size -- maximum size of a search workspace, in bytes, 0 if unchecked
     graphs -- list of graphs
 
   """
 
   def __init__(self, script):
     self.max_path_size = None
+    self.cache_size = 0
+    self.stats = False
+    self.reservations = False
+    self.static_workspace = False
+    self.max_workspace_size = 0
     self.graphs = []
 
     def set_max_path_size(n):
@@ -110,13 +650,54 @@ class CodeGenerator:
         raise ValueError("invalid max path size")
       self.max_path_size = int(n)
 
-    def add_graph(name, nodes, vertices):
-      self.graphs.append(Graph(name, nodes, vertices))
+    def set_cache_size(n):
+      if not 0 <= n <= 255:
+        raise ValueError("invalid cache size")
+      self.cache_size = int(n)
+
+    def set_stats(enabled):
+      self.stats = bool(enabled)
+
+    def set_reservations(enabled):
+      self.reservations = bool(enabled)
+
+    def set_static_workspace(enabled):
+      self.static_workspace = bool(enabled)
+
+    def set_max_workspace_size(n):
+      if n < 0:
+        raise ValueError("invalid max workspace size")
+      self.max_workspace_size = int(n)
+
+    def add_graph(name, nodes, vertices, landmarks=0, grid_cell=None):
+      self.graphs.append(Graph(name, nodes, vertices, landmarks, grid_cell))
+
+    def add_field_graph(name, size, robot_radius, polygons=(), circles=(),
+                        nodes=None, margin=1, circle_sides=8, landmarks=0, grid_cell=None):
+      builder = FieldBuilder(size[0], size[1], robot_radius, polygons, circles,
+                             nodes, margin, circle_sides)
+      graph = Graph(name, builder.nodes, builder.vertices, landmarks, grid_cell)
+      graph.stats = builder.stats
+      self.graphs.append(graph)
+
+    def add_random_graph(name, size, nodes, radius, obstacles=0, obstacle_radius=150,
+                         seed=0, landmarks=0, grid_cell=None):
+      builder = RandomBuilder(size[0], size[1], nodes, radius, obstacles, obstacle_radius, seed)
+      graph = Graph(name, builder.nodes, builder.vertices, landmarks, grid_cell)
+      graph.stats = builder.stats
+      self.graphs.append(graph)
 
     script_globals = {}
     script_locals = {
       'set_max_path_size': set_max_path_size,
+      'set_cache_size': set_cache_size,
+      'set_stats': set_stats,
+      'set_reservations': set_reservations,
+      'set_static_workspace': set_static_workspace,
+      'set_max_workspace_size': set_max_workspace_size,
       'add_graph': add_graph,
+      'add_field_graph': add_field_graph,
+      'add_random_graph': add_random_graph,
     }
 
     with open(script) as f:
@@ -132,6 +713,38 @@ class CodeGenerator:
       if graph.name in names:
         raise ValueError("duplicate graph name: %s" % graph.name)
       names.add(graph.name)
+      # node indexes must fit in an enum (int)
+      if len(graph.nodes) > 0x7fff:
+        raise ValueError("too many nodes in graph %s" % graph.name)
+    if self.max_workspace_size and self.workspace_size() > self.max_workspace_size:
+      raise ValueError("search workspace exceeds max size: %d bytes" % self.workspace_size())
+
+  def max_nodes_size(self):
+    return max(len(g.nodes) for g in self.graphs)
+
+  def index_bits(self):
+    """Return the width of node indexes
+
+    The highest value is used as invalid node index.
+    """
+    return 8 if self.max_nodes_size() < 0xff else 16
+
+  def workspace_size(self, nodes_size=None):
+    """Return the size of a search workspace, in bytes
+
+    Default size is the size of blocking searches workspace, for the largest
+    graph (see PATHFINDING_WORKSPACE_SIZE()).
+    """
+    if nodes_size is None:
+      nodes_size = self.max_nodes_size()
+    n = nodes_size + 1  # +1 for the goal position
+    index_size = self.index_bits() // 8
+    # costs, previous nodes, open set and its size, 2-bit states
+    size = 2 * n + (2 * n + 1) * index_size + (n + 3) // 4
+    return size + size % 2  # array of 16-bit elements
+
+  def max_vertices_size(self):
+    return max(g.vertices_size for g in self.graphs)
 
   def graphs_h(self):
     return '\n'.join(g.gen_h() for g in self.graphs)
@@ -144,3 +757,37 @@ if __name__ == 'avarix_templatizer':
   import sys
   template_locals = {'self': CodeGenerator(sys.argv[1])}
 
+elif __name__ == '__main__':
+  import argparse
+  parser = argparse.ArgumentParser(
+      description="Report graph statistics, A* node expansions saved by landmarks and search benchmarks")
+  parser.add_argument('config', help="pathfinding configuration script")
+  parser.add_argument('-n', '--samples', type=int, default=1000,
+      help="number of random searches per graph")
+  parser.add_argument('-b', '--benchmark', action='store_true',
+      help="compare A* searches of the Python model to Dijkstra (see test/pathfinding for the C benchmark)")
+  args = parser.parse_args()
+
+  generator = CodeGenerator(args.config)
+  print("search workspace: %d bytes, %.1f bytes per node, %s" % (
+    generator.workspace_size(), generator.workspace_size() / (generator.max_nodes_size() + 1),
+    "static" if generator.static_workspace else "on the stack of blocking searches"))
+  for graph in generator.graphs:
+    print("%s: %d nodes, %d vertices, %.1f neighbors per node" % (
+      graph.name, len(graph.nodes), len(graph.vertices), graph.vertices_size / len(graph.nodes)))
+    print("  search workspace: %d bytes" % generator.workspace_size(len(graph.nodes)))
+    for k, v in graph.stats.items():
+      print("  %s: %s" % (k, v))
+    print("  worst-case path cost: %d" % graph.max_path_cost)
+    if not graph.landmarks:
+      print("%s: no landmarks" % graph.name)
+    else:
+      searches, expansions, landmarks_expansions = graph.landmarks_report(args.samples)
+      print("%s: %d landmarks, %d searches, %.1f -> %.1f expansions per search (-%.0f%%)" % (
+        graph.name, len(graph.landmarks), searches, expansions / searches,
+        landmarks_expansions / searches, 100 * (1 - landmarks_expansions / expansions)))
+    if args.benchmark:
+      benchmark = graph.benchmark(args.samples)
+      print("%s: benchmark" % graph.name)
+      for k, v in benchmark.items():
+        print("  %s: %s" % (k, round(v, 3)))
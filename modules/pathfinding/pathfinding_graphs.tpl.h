@@ -6,6 +6,34 @@
 /// Maximum path size (as defined in `pathfinding_config.py`)
 #define PATHFINDING_MAX_PATH_SIZE  10
 
+/// Number of search results cached in path finders, 0 if disabled
+#define PATHFINDING_CACHE_SIZE  0
+
+/// Set to 1 to count search statistics in path finders
+#define PATHFINDING_STATS  0
+
+/// Set to 1 to enable node reservations and path arrival times
+#define PATHFINDING_RESERVATIONS  0
+
+/// Set to 1 to use a static workspace for blocking searches
+#define PATHFINDING_STATIC_WORKSPACE  0
+
+/// Maximum size of a search workspace, in bytes, 0 if unchecked
+#define PATHFINDING_MAX_WORKSPACE_SIZE  0
+
+/// Maximum number of nodes of configured graphs
+#define PATHFINDING_MAX_NODES_SIZE  3
+
+/// Maximum number of vertices of configured graphs, counted in both directions
+#define PATHFINDING_MAX_VERTICES_SIZE  4
+
+/// Width of node indexes, 8 or 16 bits depending on the number of nodes
+#define PATHFINDING_INDEX_BITS  8
+/// Type of node indexes
+typedef uint8_t pathfinding_index_t;
+/// Invalid node index
+#define PATHFINDING_INDEX_NONE  0xff
+
 /// List of graph nodes indexes
 enum {
   GRAPH_NODE_ALPHA,
@@ -15,11 +43,28 @@ enum {
 };
 
 /// List of graph nodes
-extern const pathfinding_node_t graph_nodes;
+extern const pathfinding_node_t graph_nodes[3];
+/// Index of the first vertex of each node, followed by the vertex count
+extern const uint16_t graph_offsets[4];
+/// Target node of each vertex
+extern const pathfinding_index_t graph_neighbors[4];
+/// Cost of each vertex
+extern const uint16_t graph_costs[4];
 
 #else
 
 #define PATHFINDING_MAX_PATH_SIZE  $$avarix:self.max_path_size$$
+#define PATHFINDING_CACHE_SIZE  $$avarix:self.cache_size$$
+#define PATHFINDING_STATS  $$avarix:int(self.stats)$$
+#define PATHFINDING_RESERVATIONS  $$avarix:int(self.reservations)$$
+#define PATHFINDING_STATIC_WORKSPACE  $$avarix:int(self.static_workspace)$$
+#define PATHFINDING_MAX_WORKSPACE_SIZE  $$avarix:self.max_workspace_size$$
+#define PATHFINDING_MAX_NODES_SIZE  $$avarix:self.max_nodes_size()$$
+#define PATHFINDING_MAX_VERTICES_SIZE  $$avarix:self.max_vertices_size()$$
+
+#define PATHFINDING_INDEX_BITS  $$avarix:self.index_bits()$$
+typedef uint$$avarix:self.index_bits()$$_t pathfinding_index_t;
+#define PATHFINDING_INDEX_NONE  UINT$$avarix:self.index_bits()$$_MAX
 
 #pragma avarix_tpl self.graphs_h()
 
@@ -32,5 +32,24 @@
 /// Uptime tick period in microseconds
 #define UPTIME_TICK_US  10000
 
+
+/** @brief Enable profiling of timer callbacks (0 or 1)
+ *
+ * When enabled, entry latency and execution time of callbacks are recorded
+ * for each channel. See \ref timer_get_profile().
+ *
+ * @note Global configuration only.
+ */
+#define TIMER_PROFILING  0
+
+/// Number of bins of profiling histograms
+#define TIMER_PROFILING_BINS  8
+
+/// Width of latency histogram bins, as a power of 2 (in ticks)
+#define TIMER_PROFILING_LATENCY_SHIFT  0
+
+/// Width of execution time histogram bins, as a power of 2 (in ticks)
+#define TIMER_PROFILING_DURATION_SHIFT  4
+
 //@}
 //@}
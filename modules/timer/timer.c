@@ -6,8 +6,12 @@
 
 /// Scheduling configuration for a single timer channel
 typedef struct {
-  uint16_t period;  ///< event period, in ticks
+  uint32_t period;  ///< event period, in ticks, 0 for one-shot events
+  uint32_t left;  ///< ticks left to wait after next compare match
   void (*callback)(void);  ///< callback to execute
+#if TIMER_PROFILING
+  timer_profile_t profile;  ///< callback profiling data
+#endif
 } timer_event_t;
 
 /// Scheduling configuration for a TCx0 timer
@@ -42,18 +46,129 @@ TC0_t *timer_get_tc(const timer_t *t)
 }
 
 
-void timer_set_callback(timer_t *t, timer_channel_t ch, uint16_t period, intlvl_t intlvl, timer_callback_t cb)
+/** @brief Consume ticks left to wait for an event
+ *
+ * Return the value to add to CCx to schedule the next compare match.
+ * Waits longer than 16 bits are split in several compare matches; 0 is
+ * returned for a whole 0x10000-tick epoch.
+ *
+ * The last two steps are split evenly: a tiny last step could be shorter
+ * than the interrupt latency, the compare match would be missed and the
+ * callback executed a whole epoch late.
+ */
+static inline uint16_t timer_event_step(timer_event_t *ev)
+{
+  if(ev->left >= 0x20000) {
+    ev->left -= 0x10000;
+    return 0;
+  } else if(ev->left > 0x10000) {
+    const uint32_t step = (ev->left + 1) / 2;  // 0x10000 is returned as 0
+    ev->left -= step;
+    return step;
+  } else if(ev->left == 0x10000) {
+    ev->left = 0;
+    return 0;
+  } else {
+    const uint16_t step = ev->left;
+    ev->left = 0;
+    return step;
+  }
+}
+
+/// Schedule an event, the first callback is executed after \e delay ticks
+static void timer_schedule(timer_t *t, timer_channel_t ch, uint32_t period, uint32_t delay, intlvl_t intlvl, timer_callback_t cb)
 {
   const uint8_t ich = ch-TIMER_CHA;
   TC0_t *const tc = t->tc;
+  timer_event_t *const ev = &t->events[ich];
   INTLVL_DISABLE_ALL_BLOCK() {
     tc->INTCTRLB = (tc->INTCTRLB & ~(3 << 2*ich)) | (intlvl << 2*ich);
-    (&tc->CCA)[ich] = tc->CNT + period;
-    t->events[ich].period = period;
-    t->events[ich].callback = cb;
+    ev->period = period;
+    ev->left = delay;
+    (&tc->CCA)[ich] = tc->CNT + timer_event_step(ev);
+    ev->callback = cb;
   }
+#if TIMER_PROFILING
+  timer_reset_profile(t, ch);
+#endif
+}
+
+void timer_set_callback(timer_t *t, timer_channel_t ch, uint32_t period, intlvl_t intlvl, timer_callback_t cb)
+{
+  if(period == 0) {
+    period = 0x10000;
+  }
+  timer_schedule(t, ch, period, period, intlvl, cb);
 }
 
+void timer_set_oneshot(timer_t *t, timer_channel_t ch, uint32_t delay, intlvl_t intlvl, timer_callback_t cb)
+{
+  if(delay == 0) {
+    delay = 0x10000;
+  }
+  timer_schedule(t, ch, 0, delay, intlvl, cb);
+}
+
+#if TIMER_PROFILING
+
+/// Reset profiling statistics of a value
+static void timer_profile_stat_reset(timer_profile_stat_t *stat)
+{
+  stat->min = 0xffff;
+  stat->max = 0;
+  for(uint8_t i=0; i<TIMER_PROFILING_BINS; i++) {
+    stat->histogram[i] = 0;
+  }
+}
+
+/// Record a value in profiling statistics
+static void timer_profile_stat_update(timer_profile_stat_t *stat, uint16_t value, uint8_t shift)
+{
+  if(value < stat->min) {
+    stat->min = value;
+  }
+  if(value > stat->max) {
+    stat->max = value;
+  }
+  uint16_t bin = value >> shift;
+  if(bin >= TIMER_PROFILING_BINS) {
+    bin = TIMER_PROFILING_BINS-1;
+  }
+  if(stat->histogram[bin] != 0xffff) {
+    stat->histogram[bin]++;
+  }
+}
+
+/// Record a callback execution, called from timer interrupts
+static void timer_profile_record(timer_profile_t *profile, uint16_t latency, uint16_t duration)
+{
+  profile->count++;
+  timer_profile_stat_update(&profile->latency, latency, TIMER_PROFILING_LATENCY_SHIFT);
+  timer_profile_stat_update(&profile->duration, duration, TIMER_PROFILING_DURATION_SHIFT);
+}
+
+void timer_get_profile(const timer_t *t, timer_channel_t ch, timer_profile_t *profile)
+{
+  const uint8_t ich = ch-TIMER_CHA;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    *profile = t->events[ich].profile;
+  }
+}
+
+void timer_reset_profile(timer_t *t, timer_channel_t ch)
+{
+  const uint8_t ich = ch-TIMER_CHA;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    timer_profile_t *profile = &t->events[ich].profile;
+    profile->count = 0;
+    timer_profile_stat_reset(&profile->latency);
+    timer_profile_stat_reset(&profile->duration);
+  }
+}
+
+#endif
+
+
 void timer_clear_callback(timer_t *t, timer_channel_t ch)
 {
   const uint8_t ich = ch-TIMER_CHA;
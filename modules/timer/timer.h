@@ -1,7 +1,7 @@
 /** @defgroup timer Timer
  * @brief Timer module
  *
- * Timers are used to schedule periodic actions.
+ * Timers are used to schedule periodic or one-shot actions.
  * Timing is ensured by a timer/counter (TC module). Events are executed on
  * compare interrupts, allowing one scheduled event per timer channel.
  *
@@ -26,6 +26,22 @@
 #include "timer_config.h"
 
 
+#ifndef TIMER_PROFILING
+# define TIMER_PROFILING  0
+#endif
+#if TIMER_PROFILING
+# ifndef TIMER_PROFILING_BINS
+#  define TIMER_PROFILING_BINS  8
+# endif
+# ifndef TIMER_PROFILING_LATENCY_SHIFT
+#  define TIMER_PROFILING_LATENCY_SHIFT  0
+# endif
+# ifndef TIMER_PROFILING_DURATION_SHIFT
+#  define TIMER_PROFILING_DURATION_SHIFT  4
+# endif
+#endif
+
+
 #ifdef DOXYGEN
 
 /// Timer state
@@ -178,11 +194,24 @@ TC0_t *timer_get_tc(const timer_t *t);
  * @param intlvl  event priority level
  * @param cb  callback to execute
  *
- * @note If \e period is 0, the actual period will be 0x10000 (maximum value).
+ * Periods longer than 0x10000 ticks are supported: the compare interrupt is
+ * triggered once per 0x10000-tick epoch, the last two epochs being split
+ * evenly, the callback is executed only when the whole period has elapsed.
+ *
+ * @note If \e period is 0, the actual period will be 0x10000.
+ */
+void timer_set_callback(timer_t *t, timer_channel_t ch, uint32_t period, intlvl_t intlvl, timer_callback_t cb);
+
+/** @brief Schedule a one-shot callback on a timer channel
+ *
+ * The callback is executed once, after \e delay ticks.
+ * Channel is then free to be used again.
+ *
+ * @note If \e delay is 0, the actual delay will be 0x10000.
  */
-void timer_set_callback(timer_t *t, timer_channel_t ch, uint16_t period, intlvl_t intlvl, timer_callback_t cb);
+void timer_set_oneshot(timer_t *t, timer_channel_t ch, uint32_t delay, intlvl_t intlvl, timer_callback_t cb);
 
-/// Cancel a scheduled periodic callback on a timer channel
+/// Cancel a scheduled callback on a timer channel
 void timer_clear_callback(timer_t *t, timer_channel_t ch);
 
 /** @brief Schedule a callback using a period in microseconds
@@ -193,6 +222,52 @@ void timer_clear_callback(timer_t *t, timer_channel_t ch);
 #define TIMER_SET_CALLBACK_US(xn,ch,us,intlvl,cb) \
     timer_set_callback(AVARIX_EVALCONCAT2(timer,xn), (ch), TIMER_US_TO_TICKS(xn,(us)), (intlvl), (cb))
 
+/** @brief Schedule a one-shot callback using a delay in microseconds
+ *
+ * This is equivalent to a call to \ref timer_set_oneshot() except that timer
+ * is provided in the XN form and delay is provided in microseconds
+ */
+#define TIMER_SET_ONESHOT_US(xn,ch,us,intlvl,cb) \
+    timer_set_oneshot(AVARIX_EVALCONCAT2(timer,xn), (ch), TIMER_US_TO_TICKS(xn,(us)), (intlvl), (cb))
+
+
+#if TIMER_PROFILING || DOXYGEN
+
+/** @brief Profiling statistics of a value
+ *
+ * Values are in timer ticks. Histogram bin \e i counts values between
+ * <tt>i << shift</tt> and <tt>((i+1) << shift) - 1</tt>; the last bin also
+ * counts larger values. Bin counts saturate at 0xffff.
+ */
+typedef struct {
+  uint16_t min;  ///< minimum value, 0xffff if no value recorded
+  uint16_t max;  ///< maximum value
+  uint16_t histogram[TIMER_PROFILING_BINS];  ///< value distribution
+} timer_profile_stat_t;
+
+/// Profiling data of a timer channel
+typedef struct {
+  uint32_t count;  ///< number of callback executions
+  /// Delay between compare match and ISR entry (CNT - CCx)
+  timer_profile_stat_t latency;
+  /// Callback execution time
+  timer_profile_stat_t duration;
+} timer_profile_t;
+
+/** @brief Retrieve profiling data of a timer channel
+ *
+ * Data is reset when a callback is scheduled or with
+ * \ref timer_reset_profile().
+ *
+ * @note Only available if \ref TIMER_PROFILING is enabled.
+ */
+void timer_get_profile(const timer_t *t, timer_channel_t ch, timer_profile_t *profile);
+
+/// Reset profiling data of a timer channel
+void timer_reset_profile(timer_t *t, timer_channel_t ch);
+
+#endif
+
 
 /// Convert microseconds to timer ticks
 #define TIMER_US_TO_TICKS(xn,us)  (((float)(us) * (CLOCK_PER_FREQ)) / ((AVARIX_EVALCONCAT3(TIMER,xn,_PRESCALER_DIV)) * 1000000UL))
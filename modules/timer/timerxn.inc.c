@@ -53,6 +53,34 @@ void timerXN(_init)(void)
 
 #define timerXN_event_X(x)  timerXN_.events[TIMER_CH##x-TIMER_CHA]
 
+/** @brief Schedule the next compare match of a channel
+ *
+ * Return the callback to execute, or null if no callback has to be executed
+ * for this match.
+ */
+static inline timer_callback_t timerXN(_event_next)(timer_event_t *ev, register16_t *cc, timer_channel_t ch)
+{
+  timer_callback_t cb = 0;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(ev->left) {
+      // period not elapsed yet
+      *cc += timer_event_step(ev);
+    } else {
+      cb = ev->callback;
+      if(ev->period) {
+        ev->left = ev->period;
+        *cc += timer_event_step(ev);
+      } else {
+        // one-shot event
+        const uint8_t ich = ch-TIMER_CHA;
+        TCXN().INTCTRLB &= ~(3 << 2*ich);
+        ev->callback = 0;
+      }
+    }
+  }
+  return cb;
+}
+
 /** @brief Interrupt handler for channel callback
  *
  * The timer counter register (CNT) is continually incremented and matched
@@ -61,20 +89,41 @@ void timerXN(_init)(void)
  * value to schedule the next execution.
  *
  * Both CNT and CCx are 16-bit values and overflow as expected.
- * As a result, period must be less than 2^16.
+ * Longer periods are split into 0x10000-tick epochs, the last two steps
+ * being split evenly: matches are counted down and the callback is only
+ * executed once the whole period has elapsed.
+ *
+ * One-shot events disable the channel interrupt before the callback is
+ * executed.
+ *
+ * When profiling is enabled, CNT is read on entry to compute the latency
+ * and the callback execution time.
  */
+#if TIMER_PROFILING
 #define TIMER_ISR_CCX(x) \
   ISR(TCXN(_CC##x##_vect)) \
   { \
-    timer_callback_t cb; \
-    INTLVL_DISABLE_ALL_BLOCK() { \
-      TCXN().CC##x += timerXN_event_X(x).period; \
-      cb = timerXN_event_X(x).callback; \
+    const uint16_t entry_cnt = TCXN().CNT; \
+    const uint16_t latency = entry_cnt - TCXN().CC##x; \
+    const timer_callback_t cb = timerXN(_event_next)(&timerXN_event_X(x), \
+                                                    &TCXN().CC##x, TIMER_CH##x); \
+    if(cb) { \
+      cb(); \
+      timer_profile_record(&timerXN_event_X(x).profile, \
+                           latency, TCXN().CNT - entry_cnt); \
     } \
+  }
+#else
+#define TIMER_ISR_CCX(x) \
+  ISR(TCXN(_CC##x##_vect)) \
+  { \
+    const timer_callback_t cb = timerXN(_event_next)(&timerXN_event_X(x), \
+                                                    &TCXN().CC##x, TIMER_CH##x); \
     if(cb) { \
       cb(); \
     } \
   }
+#endif
 
 TIMER_ISR_CCX(A)
 TIMER_ISR_CCX(B)
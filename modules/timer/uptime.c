@@ -10,6 +10,9 @@
 TIMER_CHECK_US_TO_TICKS_PRECISION(UPTIME_TIMER, UPTIME_TICK_US);
 
 
+/// Uptime tick period, in timer ticks
+#define UPTIME_TICKS  ((uint32_t)TIMER_US_TO_TICKS(UPTIME_TIMER, UPTIME_TICK_US))
+
 /// Current uptime counter
 static uint32_t uptime_val;
 
@@ -29,6 +32,23 @@ uint32_t uptime_us(void)
   return ret;
 }
 
+uint32_t uptime_us_precise(void)
+{
+  if(UPTIME_TICKS >= 0x10000) {
+    return uptime_us();
+  }
+  TC0_t *const tc = timer_get_tc(AVARIX_EVALCONCAT2(timer, UPTIME_TIMER));
+  uint32_t ret;
+  uint16_t elapsed;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    ret = uptime_val;
+    // compare register holds the counter value of the next update
+    const uint16_t cc = (&tc->CCA)[UPTIME_TIMER_CHANNEL - TIMER_CHA];
+    elapsed = tc->CNT - (uint16_t)(cc - UPTIME_TICKS);
+  }
+  return ret + ((uint32_t)elapsed * UPTIME_TICK_US + UPTIME_TICKS / 2) / UPTIME_TICKS;
+}
+
 
 void uptime_init(void)
 {
@@ -26,6 +26,17 @@ void uptime_init(void);
 /// Get current uptime in microseconds
 uint32_t uptime_us(void);
 
+/** @brief Get current uptime in microseconds, with timer tick resolution
+ *
+ * uptime_us() is only updated every \ref UPTIME_TICK_US. This function adds
+ * the time elapsed since the last update, computed from the uptime timer
+ * counter. Resolution is one timer tick.
+ *
+ * @note If the uptime tick period is longer than 0x10000 timer ticks, the
+ * result is the same as uptime_us().
+ */
+uint32_t uptime_us_precise(void);
+
 #endif
 //@}
 //@}
@@ -0,0 +1,10 @@
+/**
+ * @file
+ * @brief ADXRS configuration for host tests
+ *
+ * Captures are not timestamped, a constant capture period is assumed.
+ */
+
+#define ADXRS_SPIC_ENABLE
+#define ADXRS_SPI_PRESCALER  16
+#define ADXRS_CAPTURE_INTLVL  INTLVL_MED
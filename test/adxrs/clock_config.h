@@ -0,0 +1,10 @@
+/**
+ * @file
+ * @brief Clock configuration for host tests
+ */
+
+#define CLOCK_SOURCE  CLOCK_SOURCE_RC32M
+#define CLOCK_SYS_FREQ  32000000
+#define CLOCK_CPU_FREQ  32000000
+#define CLOCK_PER2_FREQ  CLOCK_CPU_FREQ
+#define CLOCK_PER4_FREQ  CLOCK_CPU_FREQ
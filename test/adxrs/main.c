@@ -0,0 +1,133 @@
+/** @file
+ * @brief Host test of ADXRS angle integration
+ *
+ * Captures are simulated by feeding sensor data responses to the SPI
+ * interrupt handler (see sim.h).
+ *
+ * Integrated angle is compared to an exact reference and to the former
+ * floating-point integration, which accumulates rounding errors as the angle
+ * grows.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <adxrs/adxrs.h>
+#include "sim.h"
+
+/// Number of simulated captures (10 minutes at 1kHz)
+#define CAPTURE_COUNT  600000
+/// Number of captures between two angle checks
+#define CHECK_PERIOD  1000
+
+/// Scale of an ADXRS453 (80 LSB per deg/s) captured at 1kHz, in milliradians
+#define SCALE  ((float)(M_PI / 180 / 80))
+
+
+/// Compare fixed-point and floating-point integration to exact angle
+static int test_integration(void)
+{
+  adxrs_capture_start(SCALE);
+
+  double exact = 0;
+  float float_angle = 0;
+  double fixed_max_error = 0;
+  double float_max_error = 0;
+  for(uint32_t i=0; i<CAPTURE_COUNT; i++) {
+    const int16_t speed = sim_speed(i);
+    sim_response(speed);
+    exact += (double)speed * SCALE;
+    float_angle += speed * SCALE;
+    if((i+1) % CHECK_PERIOD == 0) {
+      const double fixed_error = fabs(adxrs_get_angle() - exact);
+      const double float_error = fabs(float_angle - exact);
+      // returned angle is a float, it cannot be more accurate
+      const double max_error = 1e-6 + fabs(exact) * 1e-7;
+      if(fixed_error > max_error) {
+        printf("FAIL: capture %lu: angle %.6f, expected %.6f\n",
+               (unsigned long)i, adxrs_get_angle(), exact);
+        return 1;
+      }
+      if(fixed_error > fixed_max_error) {
+        fixed_max_error = fixed_error;
+      }
+      if(float_error > float_max_error) {
+        float_max_error = float_error;
+      }
+    }
+  }
+  adxrs_capture_stop();
+
+  printf("integration of %u captures: final angle %.3f mrad\n", CAPTURE_COUNT, exact);
+  printf("  fixed-point max error: %.3g mrad\n", fixed_max_error);
+  printf("  floating-point max error: %.3g mrad\n", float_max_error);
+  if(fixed_max_error >= float_max_error) {
+    printf("FAIL: fixed-point integration is not more accurate\n");
+    return 1;
+  }
+  return 0;
+}
+
+/// Return the angle integrated with a given scale, for a few captures
+static float integrate_with_scale(float scale)
+{
+  adxrs_capture_start(scale);
+  for(uint8_t i=0; i<10; i++) {
+    sim_response(30000);
+  }
+  adxrs_capture_stop();
+  return adxrs_get_angle();
+}
+
+/// Scales and angles out of fixed-point range are saturated
+static int test_saturation(void)
+{
+  int ret = 0;
+  // largest fixed-point scale
+  const float max_angle = integrate_with_scale(ldexpf(2147483520.0f, -40));
+  if(max_angle != 10 * 30000 * ldexpf(2147483520.0f, -40)) {
+    printf("FAIL: angle %f with the largest scale\n", max_angle);
+    ret = 1;
+  }
+  if(integrate_with_scale(1.0f) != max_angle || integrate_with_scale(INFINITY) != max_angle ||
+     integrate_with_scale(-1.0f) != -max_angle) {
+    printf("FAIL: large scales not saturated\n");
+    ret = 1;
+  }
+  if(integrate_with_scale(NAN) != 0) {
+    printf("FAIL: NaN scale not ignored\n");
+    ret = 1;
+  }
+
+  adxrs_set_angle(-1234.5f);
+  if(adxrs_get_angle() != -1234.5f) {
+    printf("FAIL: angle not set\n");
+    ret = 1;
+  }
+  adxrs_set_angle(NAN);
+  if(adxrs_get_angle() != -1234.5f) {
+    printf("FAIL: NaN angle not ignored\n");
+    ret = 1;
+  }
+  adxrs_set_angle(1e30f);
+  const float high = adxrs_get_angle();
+  adxrs_set_angle(-INFINITY);
+  const float low = adxrs_get_angle();
+  if(high != ldexpf(1, 22) || low != -ldexpf(1, 22)) {
+    printf("FAIL: angles saturated to %f and %f\n", high, low);
+    ret = 1;
+  }
+  printf("saturation: largest scale angle %.3f, angles saturated to +/-%.0f\n", max_angle, high);
+  return ret;
+}
+
+int main(void)
+{
+  // emulated SPI transfers complete immediately
+  SPIC.STATUS = SPI_IF_bm;
+  adxrs_init(PORTPIN(C,4));
+
+  int ret = 0;
+  ret |= test_integration();
+  ret |= test_saturation();
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
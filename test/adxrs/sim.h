@@ -0,0 +1,60 @@
+/** @file
+ * @brief Simulation of ADXRS captures, shared by ADXRS host tests
+ *
+ * Sensor data responses are fed to the SPI interrupt handler, one byte at a
+ * time. Simulated angle speeds are those of a robot slowly drifting while
+ * turning back and forth, with sensor noise.
+ */
+#ifndef TEST_ADXRS_SIM_H__
+#define TEST_ADXRS_SIM_H__
+
+#include <stdint.h>
+#include <math.h>
+#include <avr/io.h>
+
+void SPIC_INT_vect(void);
+
+/// Pseudo-random generator, for reproducible runs
+static uint32_t lcg_state = 1;
+static inline uint16_t lcg_rand(uint16_t n)
+{
+  lcg_state = lcg_state * 1103515245 + 12345;
+  return (lcg_state >> 16) % n;
+}
+
+/// Simulated angle speed of capture i, in LSB
+static inline int16_t sim_speed(uint32_t i)
+{
+  // 15 deg/s drift, turns at up to 100 deg/s
+  return 1200 + lround(8000 * sin(2 * M_PI * i / 20000)) + lcg_rand(9) - 4;
+}
+
+/// Build a sensor data response
+static inline void sim_response_data(int16_t speed, uint8_t data[4])
+{
+  const uint16_t v = speed;
+  data[0] = 0x04 | (v >> 14);  // status 1, no sequence bits
+  data[1] = v >> 6;
+  data[2] = v << 2;
+  data[3] = 0;
+  // P0 and P1 make odd parities
+  if(!__builtin_parity(data[0] ^ data[1])) {
+    data[0] |= 0x10;
+  }
+  if(!__builtin_parity(data[0] ^ data[1] ^ data[2] ^ data[3])) {
+    data[3] |= 0x01;
+  }
+}
+
+/// Feed a sensor data response to the capture handler
+static inline void sim_response(int16_t speed)
+{
+  uint8_t data[4];
+  sim_response_data(speed, data);
+  for(uint8_t i=0; i<4; i++) {
+    SPIC.DATA = data[i];
+    SPIC_INT_vect();
+  }
+}
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file
+ * @brief ADXRS configuration for host tests of timestamped DMA captures
+ */
+
+#define ADXRS_SPIC_ENABLE
+#define ADXRS_SPI_PRESCALER  16
+#define ADXRS_CAPTURE_INTLVL  INTLVL_MED
+
+#define ADXRS_TIMESTAMP_TIMER  E0
+#define ADXRS_TIMESTAMP_PRESCALER_DIV  1
+#define ADXRS_TIMESTAMP_CH  D
+#define ADXRS_SAMPLES_LENGTH  16
+
+#define ADXRS_DMA_TC  TCD1
+#define ADXRS_DMA_PRESCALER_DIV  8
+#define ADXRS_DMA_RX_CH  0
+#define ADXRS_DMA_TX_CH  1
+#define ADXRS_DMA_START_CH  2
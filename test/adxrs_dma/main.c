@@ -0,0 +1,208 @@
+/** @file
+ * @brief Host test of ADXRS DMA capture mode, with timestamps
+ *
+ * DMA transfers are not emulated. Captures are simulated by writing sensor
+ * data responses to the buffer the RX channel is armed on, then executing the
+ * channel ISR. The timestamp counter is advanced with the interrupt latency
+ * jitter, which must not affect sample times.
+ *
+ * @note Ordering of the TX and RX channels on the shared SPI trigger and the
+ * clearing of the SPI flag by DMA reads are not emulated.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <clock/defs.h>
+#include <adxrs/adxrs.h>
+#include "adxrs_config.h"
+#include "../adxrs/sim.h"
+
+void DMA_CH0_vect(void);
+
+/// DMA TC period, in DMA TC ticks (1kHz)
+#define DMA_PERIOD  4000
+/// Capture period, in timestamp ticks
+#define CAPTURE_TICKS  (DMA_PERIOD * ADXRS_DMA_PRESCALER_DIV / ADXRS_TIMESTAMP_PRESCALER_DIV)
+/// Number of simulated captures
+#define CAPTURE_COUNT  10000
+
+/// Timer ticks per second
+#define TICKS_PER_SECOND  ((double)CLOCK_PER_FREQ / ADXRS_TIMESTAMP_PRESCALER_DIV)
+
+/// Scale of an ADXRS453 (80 LSB per deg/s), in milliradians per second
+#define SCALE  ((float)(M_PI / 180 / 80 * 1000))
+/// Scale per tick
+#define TICK_SCALE  (SCALE / TICKS_PER_SECOND)
+
+#define ARRAY_SIZE(a)  (sizeof(a) / sizeof(*(a)))
+
+/// Variable located near module data, to resolve 16-bit DMA addresses
+static uint8_t host_data_anchor;
+
+/** @brief Return the host pointer of a 16-bit DMA address
+ *
+ * Module data is close to test data: the candidate nearest to a test
+ * variable is used.
+ */
+static uint8_t *sim_dma_pointer(uint16_t addr)
+{
+  const uintptr_t anchor = (uintptr_t)&host_data_anchor;
+  uintptr_t p = (anchor & ~(uintptr_t)0xffff) | addr;
+  if(p > anchor && p - anchor > 0x8000) {
+    p -= 0x10000;
+  } else if(p < anchor && anchor - p > 0x8000) {
+    p += 0x10000;
+  }
+  return (uint8_t *)p;
+}
+
+/** @brief Simulate a DMA capture
+ *
+ * Channel flags are cleared by writing them, which the emulated register
+ * does not do: the module writes them when arming channels, they are cleared
+ * here instead before setting the flag of the simulated transfer.
+ *
+ * @param latency  ticks between the capture and the ISR execution
+ * @param speed  captured speed
+ * @param error  if true, simulate a transfer error
+ */
+static void sim_dma_capture(uint16_t latency, int16_t speed, bool error)
+{
+  static uint16_t cnt;
+  cnt += CAPTURE_TICKS;
+  TCE0.CNT = cnt + latency;
+  DMA.CH0.CTRLB &= ~(DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm);
+  if(error) {
+    DMA.CH0.CTRLB |= DMA_CH_ERRIF_bm;
+  } else {
+    const uint16_t addr = DMA.CH0.DESTADDR0 | (DMA.CH0.DESTADDR1 << 8);
+    sim_response_data(speed, sim_dma_pointer(addr));
+    DMA.CH0.CTRLB |= DMA_CH_TRNIF_bm;
+  }
+  DMA_CH0_vect();
+}
+
+/// Return true if DMA channels are armed for the next capture
+static bool dma_armed(void)
+{
+  return (DMA.CH0.CTRLA & DMA_CH_ENABLE_bm) && DMA.CH0.TRFCNT == 4 &&
+      (DMA.CH1.CTRLA & DMA_CH_ENABLE_bm) && DMA.CH1.TRFCNT == 3;
+}
+
+
+/// DMA channels and TC are configured
+static int test_setup(void)
+{
+  adxrs_capture_start_dma(SCALE, DMA_PERIOD);
+  int ret = 0;
+  if(SPIC.INTCTRL != 0) {
+    printf("FAIL: SPI interrupt enabled in DMA mode\n");
+    ret = 1;
+  }
+  if(!(DMA.CTRL & DMA_ENABLE_bm)) {
+    printf("FAIL: DMA controller not enabled\n");
+    ret = 1;
+  }
+  if(DMA.CH2.TRIGSRC != DMA_CH_TRIGSRC_TCD1_OVF_gc || !(DMA.CH2.CTRLA & DMA_CH_REPEAT_bm) ||
+     !(DMA.CH2.CTRLA & DMA_CH_ENABLE_bm)) {
+    printf("FAIL: start channel not triggered by TC overflows\n");
+    ret = 1;
+  }
+  if(DMA.CH0.TRIGSRC != DMA_CH_TRIGSRC_SPIC_gc || DMA.CH1.TRIGSRC != DMA_CH_TRIGSRC_SPIC_gc ||
+     !dma_armed()) {
+    printf("FAIL: RX and TX channels not armed on SPI\n");
+    ret = 1;
+  }
+  const uint8_t intlvl = (ADXRS_CAPTURE_INTLVL << DMA_CH_ERRINTLVL_gp) |
+      (ADXRS_CAPTURE_INTLVL << DMA_CH_TRNINTLVL_gp);
+  if((DMA.CH0.CTRLB & 0x0f) != intlvl) {
+    printf("FAIL: RX channel interrupts not enabled\n");
+    ret = 1;
+  }
+  if(TCD1.PER != DMA_PERIOD - 1 || TCD1.CTRLA != 4) {
+    printf("FAIL: TC period %u, clock selection %u\n", TCD1.PER, TCD1.CTRLA);
+    ret = 1;
+  }
+  adxrs_capture_stop();
+  printf("setup: TC period %u, RX and TX channels armed on SPI\n", TCD1.PER + 1);
+  return ret;
+}
+
+/// Sample times are derived from the TC period, not from the ISR latency
+static int test_timestamps(void)
+{
+  adxrs_capture_start_dma(SCALE, DMA_PERIOD);
+  adxrs_sample_t samples[2];
+  double exact = 0;
+  int16_t prev_speed = 0;
+  for(uint32_t i=0; i<CAPTURE_COUNT; i++) {
+    const int16_t speed = sim_speed(i);
+    sim_dma_capture(lcg_rand(500), speed, false);
+    if(i > 0) {
+      exact += (prev_speed + speed) * (double)CAPTURE_TICKS * TICK_SCALE / 2;
+      if(adxrs_get_samples(samples, ARRAY_SIZE(samples)) != 2 ||
+         samples[0].time - samples[1].time != CAPTURE_TICKS) {
+        printf("FAIL: capture %lu: sample time not derived from the period\n", (unsigned long)i);
+        return 1;
+      }
+    }
+    prev_speed = speed;
+  }
+  adxrs_capture_stop();
+
+  const double error = fabs(adxrs_get_angle() - exact);
+  printf("timestamps: %u captures, %u ticks apart, angle %.6f, expected %.6f\n",
+         CAPTURE_COUNT, CAPTURE_TICKS, adxrs_get_angle(), exact);
+  if(error > 1e-6 + fabs(exact) * 3e-7) {
+    printf("FAIL: integration error %.3g mrad\n", error);
+    return 1;
+  }
+  return 0;
+}
+
+/// A transfer error drops the capture, the next one is integrated over two periods
+static int test_error(void)
+{
+  adxrs_capture_start_dma(SCALE, DMA_PERIOD);
+  sim_dma_capture(100, 1000, false);
+  sim_dma_capture(100, 1000, false);
+  const float angle = adxrs_get_angle();
+  int ret = 0;
+
+  sim_dma_capture(100, 0, true);
+  if(adxrs_get_angle() != angle) {
+    printf("FAIL: capture with a transfer error integrated\n");
+    ret = 1;
+  }
+  if(!dma_armed()) {
+    printf("FAIL: DMA channels not re-armed after a transfer error\n");
+    ret = 1;
+  }
+
+  sim_dma_capture(100, 3000, false);
+  const double expected = angle + (1000 + 3000) * (double)(2 * CAPTURE_TICKS) * TICK_SCALE / 2;
+  adxrs_sample_t samples[2];
+  if(fabs(adxrs_get_angle() - expected) > 1e-6 ||
+     adxrs_get_samples(samples, ARRAY_SIZE(samples)) != 2 ||
+     samples[0].time - samples[1].time != 2 * CAPTURE_TICKS) {
+    printf("FAIL: capture after a transfer error not integrated over two periods\n");
+    ret = 1;
+  }
+  adxrs_capture_stop();
+  printf("error: capture %s\n", ret ? "not dropped" : "dropped, next one integrated");
+  return ret;
+}
+
+
+int main(void)
+{
+  // emulated SPI transfers complete immediately
+  SPIC.STATUS = SPI_IF_bm;
+  adxrs_init(PORTPIN(C,4));
+
+  int ret = 0;
+  ret |= test_setup();
+  ret |= test_timestamps();
+  ret |= test_error();
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
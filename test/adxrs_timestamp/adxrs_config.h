@@ -0,0 +1,13 @@
+/**
+ * @file
+ * @brief ADXRS configuration for host tests of timestamped captures
+ */
+
+#define ADXRS_SPIC_ENABLE
+#define ADXRS_SPI_PRESCALER  16
+#define ADXRS_CAPTURE_INTLVL  INTLVL_MED
+
+#define ADXRS_TIMESTAMP_TIMER  E0
+#define ADXRS_TIMESTAMP_PRESCALER_DIV  1
+#define ADXRS_SAMPLES_LENGTH  16
+#define ADXRS_TIMESTAMP_CH  D
@@ -0,0 +1,316 @@
+/** @file
+ * @brief Host test of ADXRS timestamped angle integration
+ *
+ * Captures are simulated by advancing the counter of the timestamp timer,
+ * then feeding sensor data responses to the SPI interrupt handler (see
+ * ../adxrs/sim.h). Capture periods are jittered.
+ *
+ * Integrated angle is compared to an exact trapezoidal integration and to
+ * the former scale per tick, stored with 40 fractional bits only.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <clock/defs.h>
+#include <adxrs/adxrs.h>
+#include "adxrs_config.h"
+#include "../adxrs/sim.h"
+
+/// Number of simulated captures (10 minutes at 1kHz)
+#define CAPTURE_COUNT  600000
+/// Number of captures between two angle checks
+#define CHECK_PERIOD  1000
+
+/// Timer ticks per second
+#define TICKS_PER_SECOND  ((double)CLOCK_PER_FREQ / ADXRS_TIMESTAMP_PRESCALER_DIV)
+
+/// Scale of an ADXRS453 (80 LSB per deg/s), in milliradians per second
+#define SCALE  ((float)(M_PI / 180 / 80 * 1000))
+/// Scale per tick
+#define TICK_SCALE  (SCALE / TICKS_PER_SECOND)
+
+#define ARRAY_SIZE(a)  (sizeof(a) / sizeof(*(a)))
+
+/** @brief Advance the timestamp counter, feed a sensor data response
+ *
+ * The compare flag of the wrap detection channel is set if the counter
+ * reaches the compare value. The module clears it by writing it, which the
+ * emulated register does not do: it is cleared here instead, since each
+ * capture reads and clears it.
+ */
+static void sim_capture(uint32_t dt, int16_t speed)
+{
+  TCE0.INTFLAGS = 0;
+  const uint16_t d = TCE0.CCD - TCE0.CNT;
+  if(dt >= (d ? d : 0x10000)) {
+    TCE0.INTFLAGS = TC0_CCDIF_bm;
+  }
+  TCE0.CNT += dt;
+  sim_response(speed);
+}
+
+
+/// Compare integration to exact angle, with jittered captures at 1kHz
+static int test_integration(void)
+{
+  adxrs_capture_start(SCALE);
+
+  const double tick_scale = SCALE / TICKS_PER_SECOND;
+  // former scale per tick, integrated the same way
+  const int64_t former_scale = llround(ldexp(tick_scale, 40));
+  int64_t former_angle = 0;
+
+  double exact = 0;
+  double max_error = 0;
+  double former_max_error = 0;
+  int16_t prev_speed = 0;
+  for(uint32_t i=0; i<CAPTURE_COUNT; i++) {
+    const uint16_t dt = TICKS_PER_SECOND / 1000 - 3000 + lcg_rand(6000);
+    const int16_t speed = sim_speed(i);
+    sim_capture(dt, speed);
+    // first capture is not integrated
+    if(i > 0) {
+      const int64_t delta = (int64_t)(prev_speed + speed) * dt;
+      exact += delta * tick_scale / 2;
+      former_angle += (delta * former_scale) >> 1;
+    }
+    prev_speed = speed;
+    if((i+1) % CHECK_PERIOD == 0) {
+      const double error = fabs(adxrs_get_angle() - exact);
+      const double former_error = fabs(ldexp(former_angle, -40) - exact);
+      // returned angle is a float, the scale has 24 significant bits
+      if(error > 1e-6 + fabs(exact) * 3e-7) {
+        printf("FAIL: capture %lu: angle %.6f, expected %.6f\n",
+               (unsigned long)i, adxrs_get_angle(), exact);
+        return 1;
+      }
+      if(error > max_error) {
+        max_error = error;
+      }
+      if(former_error > former_max_error) {
+        former_max_error = former_error;
+      }
+    }
+  }
+  adxrs_capture_stop();
+
+  printf("integration of %u timestamped captures: final angle %.3f mrad\n", CAPTURE_COUNT, exact);
+  printf("  scale per tick: %.4g, former fixed-point value %lld\n", tick_scale, (long long)former_scale);
+  printf("  max error: %.3g mrad\n", max_error);
+  printf("  former scale max error: %.3g mrad\n", former_max_error);
+  if(max_error >= former_max_error) {
+    printf("FAIL: integration is not more accurate than with the former scale\n");
+    return 1;
+  }
+  return 0;
+}
+
+/// Long captures at full rate with the largest scale do not overflow
+static int test_large_steps(void)
+{
+  // about 32000 units per capture
+  const float scale = ldexpf(1, -16) * TICKS_PER_SECOND;
+  adxrs_capture_start(scale);
+
+  const double tick_scale = scale / TICKS_PER_SECOND;
+  double exact = 0;
+  int16_t prev_speed = 0;
+  for(uint32_t i=0; i<100; i++) {
+    const uint16_t dt = 0xffff - lcg_rand(100);
+    const int16_t speed = 32000 - lcg_rand(1000);
+    sim_capture(dt, speed);
+    if(i > 0) {
+      exact += (int64_t)(prev_speed + speed) * dt * tick_scale / 2;
+    }
+    prev_speed = speed;
+  }
+  adxrs_capture_stop();
+
+  const double error = fabs(adxrs_get_angle() - exact);
+  printf("large steps: angle %.6f, expected %.6f\n", adxrs_get_angle(), exact);
+  if(error > fabs(exact) * 1e-6) {
+    printf("FAIL: large steps integration error %.3g mrad\n", error);
+    return 1;
+  }
+  return 0;
+}
+
+/// Return the angle integrated with a given scale, for a few captures
+static float integrate_with_scale(float scale)
+{
+  adxrs_capture_start(scale);
+  for(uint8_t i=0; i<5; i++) {
+    sim_capture(1000, 1000);
+  }
+  adxrs_capture_stop();
+  return adxrs_get_angle();
+}
+
+/// Scales out of fixed-point range are saturated, NaN is ignored
+static int test_scale_range(void)
+{
+  int ret = 0;
+  // 4 integrated captures, largest mantissa without shift
+  const double max_angle = ldexp(4 * 2000 * 1000 * (double)0xffffff, -40);
+  const float angle = integrate_with_scale(ldexpf(1, -13) * TICKS_PER_SECOND);
+  if(fabs(angle - max_angle) > max_angle * 1e-6 ||
+     integrate_with_scale(INFINITY) != angle || integrate_with_scale(-1e30f) != -angle) {
+    printf("FAIL: large scales not saturated\n");
+    ret = 1;
+  }
+  if(integrate_with_scale(NAN) != 0 || integrate_with_scale(0) != 0) {
+    printf("FAIL: NaN or null scale integrated\n");
+    ret = 1;
+  }
+  printf("scale range: largest scale angle %.6f, expected %.6f\n", angle, max_angle);
+  return ret;
+}
+
+/// Samples are returned newest first, up to the buffer length
+static int test_samples(void)
+{
+  adxrs_capture_start(SCALE);
+  adxrs_sample_t samples[ADXRS_SAMPLES_LENGTH + 2];
+  if(adxrs_get_samples(samples, ARRAY_SIZE(samples)) != 0) {
+    printf("FAIL: samples returned before the first capture\n");
+    return 1;
+  }
+
+  // fill the buffer more than twice
+  const uint16_t count = 2 * ADXRS_SAMPLES_LENGTH + 3;
+  uint32_t times[2 * ADXRS_SAMPLES_LENGTH + 3];
+  uint32_t time = 0;
+  for(uint16_t i=0; i<count; i++) {
+    time += 1000 + lcg_rand(1000);
+    times[i] = time;
+    sim_capture(times[i] - (i ? times[i-1] : 0), 100 + i);
+    const uint8_t n = adxrs_get_samples(samples, ARRAY_SIZE(samples));
+    const uint8_t expected = i < ADXRS_SAMPLES_LENGTH ? i + 1 : ADXRS_SAMPLES_LENGTH;
+    if(n != expected) {
+      printf("FAIL: capture %u: %u samples, expected %u\n", i, n, expected);
+      return 1;
+    }
+    for(uint8_t k=0; k<n; k++) {
+      if(samples[k].rate != 100 + i - k || samples[k].time != times[i-k]) {
+        printf("FAIL: capture %u: unexpected sample %u\n", i, k);
+        return 1;
+      }
+    }
+  }
+  // fewer samples than available
+  if(adxrs_get_samples(samples, 3) != 3 || samples[0].rate != 100 + count - 1 ||
+     samples[2].rate != 100 + count - 3) {
+    printf("FAIL: partial retrieval of samples\n");
+    return 1;
+  }
+  adxrs_capture_stop();
+  printf("samples: %u captures, last %u samples returned in order\n", count, ADXRS_SAMPLES_LENGTH);
+  return 0;
+}
+
+/// Return true if the angle moved by the integration of a sample
+static bool angle_integrated(float before, int16_t prev_speed, int16_t speed, uint32_t dt)
+{
+  const double expected = before + (prev_speed + speed) * (double)dt * TICK_SCALE / 2;
+  return fabs(adxrs_get_angle() - expected) <= 1e-6;
+}
+
+/// Captures 0x10000 ticks or more apart are not integrated
+static int test_wrap(void)
+{
+  static const uint32_t late_dts[] = { 0x10000, 0x10001, 0x18000, 0x2fff0 };
+  adxrs_capture_start(SCALE);
+  sim_capture(32000, 1000);
+  int ret = 0;
+  for(uint8_t i=0; i<ARRAY_SIZE(late_dts); i++) {
+    float angle = adxrs_get_angle();
+    sim_capture(late_dts[i], 2000);
+    if(adxrs_get_angle() != angle) {
+      printf("FAIL: sample integrated after %lu ticks\n", (unsigned long)late_dts[i]);
+      ret = 1;
+    }
+    // next capture is integrated again
+    angle = adxrs_get_angle();
+    sim_capture(32000, 1000);
+    if(!angle_integrated(angle, 2000, 1000, 32000)) {
+      printf("FAIL: sample not integrated after a wrap\n");
+      ret = 1;
+    }
+  }
+  // longest capture period
+  const float angle = adxrs_get_angle();
+  sim_capture(0xffff, 1000);
+  if(!angle_integrated(angle, 1000, 1000, 0xffff)) {
+    printf("FAIL: sample not integrated after 0xffff ticks\n");
+    ret = 1;
+  }
+  adxrs_capture_stop();
+  printf("wrap: late samples %s\n", ret ? "integrated" : "skipped");
+  return ret;
+}
+
+/// Raw samples captured in calibration mode are not integrated nor recorded
+static int test_calibration(void)
+{
+  adxrs_capture_start(SCALE);
+  sim_capture(32000, 500);
+  sim_capture(32000, 500);
+  adxrs_sample_t samples[ADXRS_SAMPLES_LENGTH];
+  const uint8_t n = adxrs_get_samples(samples, ARRAY_SIZE(samples));
+
+  int ret = 0;
+  adxrs_calibration_mode(true);
+  for(uint8_t i=0; i<10; i++) {
+    sim_capture(32000, 50);
+  }
+  adxrs_calibration_mode(false);
+  if(adxrs_get_offset() != 50) {
+    printf("FAIL: calibration offset %d, expected 50\n", adxrs_get_offset());
+    ret = 1;
+  }
+  if(adxrs_get_samples(samples, ARRAY_SIZE(samples)) != n || samples[0].rate != 500) {
+    printf("FAIL: samples recorded in calibration mode\n");
+    ret = 1;
+  }
+
+  // first sample after calibration has no valid previous sample
+  float angle = adxrs_get_angle();
+  sim_capture(32000, 150);
+  if(adxrs_get_angle() != angle) {
+    printf("FAIL: sample integrated with a calibration sample\n");
+    ret = 1;
+  }
+  angle = adxrs_get_angle();
+  sim_capture(32000, 150);
+  if(!angle_integrated(angle, 100, 100, 32000)) {
+    printf("FAIL: sample not integrated after calibration\n");
+    ret = 1;
+  }
+  adxrs_capture_stop();
+
+  // restore a null offset
+  adxrs_capture_start(SCALE);
+  adxrs_calibration_mode(true);
+  sim_capture(32000, 0);
+  adxrs_calibration_mode(false);
+  adxrs_capture_stop();
+  printf("calibration: previous sample %s\n", ret ? "used" : "invalidated");
+  return ret;
+}
+
+
+int main(void)
+{
+  // emulated SPI transfers complete immediately
+  SPIC.STATUS = SPI_IF_bm;
+  adxrs_init(PORTPIN(C,4));
+
+  int ret = 0;
+  ret |= test_integration();
+  ret |= test_large_steps();
+  ret |= test_scale_range();
+  ret |= test_samples();
+  ret |= test_wrap();
+  ret |= test_calibration();
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
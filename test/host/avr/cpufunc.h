@@ -0,0 +1,9 @@
+/** @file
+ * @brief Host emulation of avr/cpufunc.h
+ */
+#ifndef HOST_AVR_CPUFUNC_H__
+#define HOST_AVR_CPUFUNC_H__
+
+#define _NOP()
+
+#endif
@@ -0,0 +1,20 @@
+/** @file
+ * @brief Host emulation of avr/interrupt.h
+ *
+ * Interrupt handlers are regular functions, called by tests to simulate
+ * interrupts. Global interrupt flag is ignored.
+ *
+ * Tests may set \ref host_cli_hook to simulate an interrupt executed just
+ * before interrupts are disabled.
+ */
+#ifndef HOST_AVR_INTERRUPT_H__
+#define HOST_AVR_INTERRUPT_H__
+
+/// Function called by cli(), if set
+void (*host_cli_hook)(void) __attribute__((weak));
+
+#define ISR(vector)  void vector(void); void vector(void)
+#define sei()
+#define cli()  do { if(host_cli_hook) { host_cli_hook(); } } while(0)
+
+#endif
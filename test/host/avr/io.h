@@ -0,0 +1,194 @@
+/** @file
+ * @brief Host emulation of XMEGA I/O registers
+ *
+ * Replaces avr/io.h when modules are built for host tests. Only registers and
+ * bit values used by tested modules are provided. Registers are plain global
+ * variables that tests read and write to simulate the hardware.
+ */
+#ifndef HOST_AVR_IO_H__
+#define HOST_AVR_IO_H__
+
+#include <stdint.h>
+
+#ifndef HOST_VERSION
+# error host avr/io.h must only be used with HOST_VERSION
+#endif
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+/// Define an emulated register, shared by all objects
+#define HOST_REGISTER(type, name)  type name __attribute__((weak))
+
+
+/** @name CPU */
+//@{
+HOST_REGISTER(register8_t, CCP);
+#define CCP_IOREG_gc  0xD8
+
+typedef struct { register8_t CTRL, STATUS; } RST_t;
+HOST_REGISTER(RST_t, RST);
+#define RST_SWRST_bm  0x01
+
+typedef struct { register8_t STATUS, INTPRI, CTRL; } PMIC_t;
+HOST_REGISTER(PMIC_t, PMIC);
+//@}
+
+
+/** @name Clock */
+//@{
+typedef struct {
+  register8_t CTRL, STATUS, XOSCCTRL, XOSCFAIL, RC32KCAL, PLLCTRL, DFLLCTRL;
+} OSC_t;
+HOST_REGISTER(OSC_t, OSC);
+#define OSC_RC2MEN_bm  0x01
+#define OSC_RC32MEN_bm  0x02
+#define OSC_RC32KEN_bm  0x04
+#define OSC_XOSCEN_bm  0x08
+#define OSC_PLLEN_bm  0x10
+#define OSC_RC2MRDY_bm  0x01
+#define OSC_RC32MRDY_bm  0x02
+#define OSC_RC32KRDY_bm  0x04
+#define OSC_XOSCRDY_bm  0x08
+#define OSC_PLLRDY_bm  0x10
+
+typedef struct { register8_t CTRL, PSCTRL, LOCK, RTCCTRL; } CLK_t;
+HOST_REGISTER(CLK_t, CLK);
+#define CLK_SCLKSEL_gm  0x07
+#define CLK_SCLKSEL_RC2M_gc  0x00
+#define CLK_SCLKSEL_RC32M_gc  0x01
+#define CLK_SCLKSEL_RC32K_gc  0x02
+#define CLK_SCLKSEL_XOSC_gc  0x03
+#define CLK_SCLKSEL_PLL_gc  0x04
+#define CLK_PSADIV_1_gc  0x00
+#define CLK_PSBCDIV_1_1_gc  0x00
+//@}
+
+
+/** @name Timers/counters */
+//@{
+typedef struct {
+  register8_t CTRLA, CTRLB, CTRLC, CTRLD, CTRLE, reserved_0x05;
+  register8_t INTCTRLA, INTCTRLB, CTRLFCLR, CTRLFSET, CTRLGCLR, CTRLGSET;
+  register8_t INTFLAGS, reserved_0x0D[0x13];
+  register16_t CNT, reserved_0x22[2], PER, CCA, CCB, CCC, CCD;
+} TC0_t;
+
+typedef struct {
+  register8_t CTRLA, CTRLB, CTRLC, CTRLD, CTRLE, reserved_0x05;
+  register8_t INTCTRLA, INTCTRLB, CTRLFCLR, CTRLFSET, CTRLGCLR, CTRLGSET;
+  register8_t INTFLAGS, reserved_0x0D[0x13];
+  register16_t CNT, reserved_0x22[2], PER, CCA, CCB;
+} TC1_t;
+
+#define TC0_OVFIF_bm  0x01
+#define TC0_CCAIF_bm  0x10
+#define TC0_CCBIF_bm  0x20
+#define TC0_CCCIF_bm  0x40
+#define TC0_CCDIF_bm  0x80
+#define TC1_OVFIF_bm  0x01
+#define TC1_CCAIF_bm  0x10
+#define TC1_CCBIF_bm  0x20
+
+HOST_REGISTER(TC0_t, TCC0);
+HOST_REGISTER(TC1_t, TCC1);
+HOST_REGISTER(TC0_t, TCD0);
+HOST_REGISTER(TC1_t, TCD1);
+HOST_REGISTER(TC0_t, TCE0);
+HOST_REGISTER(TC1_t, TCE1);
+HOST_REGISTER(TC0_t, TCF0);
+HOST_REGISTER(TC1_t, TCF1);
+// used to detect TCx0 timers, which have C and D channels
+#define TCC0_CCC_vect_num  1
+#define TCD0_CCC_vect_num  1
+#define TCE0_CCC_vect_num  1
+#define TCF0_CCC_vect_num  1
+//@}
+
+
+/** @name Ports */
+//@{
+typedef struct {
+  register8_t DIR, DIRSET, DIRCLR, DIRTGL, OUT, OUTSET, OUTCLR, OUTTGL;
+  register8_t IN, INTCTRL, INT0MASK, INT1MASK, INTFLAGS, REMAP, reserved_0x0E[2];
+  register8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL, PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+HOST_REGISTER(PORT_t, PORTA);
+HOST_REGISTER(PORT_t, PORTB);
+HOST_REGISTER(PORT_t, PORTC);
+HOST_REGISTER(PORT_t, PORTD);
+HOST_REGISTER(PORT_t, PORTE);
+HOST_REGISTER(PORT_t, PORTF);
+#define PORT_INT0LVL_gm  0x03
+//@}
+
+
+/** @name SPI */
+//@{
+typedef struct { register8_t CTRL, INTCTRL, STATUS, DATA; } SPI_t;
+HOST_REGISTER(SPI_t, SPIC);
+HOST_REGISTER(SPI_t, SPID);
+HOST_REGISTER(SPI_t, SPIE);
+HOST_REGISTER(SPI_t, SPIF);
+#define SPI_CLK2X_bm  0x80
+#define SPI_ENABLE_bm  0x40
+#define SPI_MASTER_bm  0x10
+#define SPI_MODE_0_gc  0x00
+#define SPI_PRESCALER_DIV4_gc  0x00
+#define SPI_PRESCALER_DIV16_gc  0x01
+#define SPI_PRESCALER_DIV64_gc  0x02
+#define SPI_PRESCALER_DIV128_gc  0x03
+#define SPI_IF_bm  0x80
+//@}
+
+
+/** @name DMA controller
+ *
+ * Transfers are not emulated: tests copy data and call channel ISRs.
+ */
+//@{
+typedef struct {
+  register8_t CTRLA, CTRLB, ADDRCTRL, TRIGSRC;
+  register16_t TRFCNT;
+  register8_t REPCNT, reserved_0x07;
+  register8_t SRCADDR0, SRCADDR1, SRCADDR2, reserved_0x0B;
+  register8_t DESTADDR0, DESTADDR1, DESTADDR2, reserved_0x0F;
+} DMA_CH_t;
+
+typedef struct {
+  register8_t CTRL, reserved_0x01[2], INTFLAGS, STATUS, reserved_0x05;
+  register16_t TEMP;
+  register8_t reserved_0x08[8];
+  DMA_CH_t CH0, CH1, CH2, CH3;
+} DMA_t;
+
+HOST_REGISTER(DMA_t, DMA);
+#define DMA_ENABLE_bm  0x80
+#define DMA_CH_ENABLE_bm  0x80
+#define DMA_CH_REPEAT_bm  0x20
+#define DMA_CH_SINGLE_bm  0x04
+#define DMA_CH_BURSTLEN_1BYTE_gc  0x00
+#define DMA_CH_ERRIF_bm  0x20
+#define DMA_CH_TRNIF_bm  0x10
+#define DMA_CH_ERRINTLVL_gp  2
+#define DMA_CH_TRNINTLVL_gp  0
+#define DMA_CH_SRCRELOAD_NONE_gc  0x00
+#define DMA_CH_SRCDIR_FIXED_gc  0x00
+#define DMA_CH_DESTRELOAD_NONE_gc  0x00
+#define DMA_CH_DESTDIR_FIXED_gc  0x00
+#define DMA_CH_DESTDIR_INC_gc  0x01
+#define DMA_CH_TRIGSRC_TCC0_OVF_gc  0x40
+#define DMA_CH_TRIGSRC_TCC1_OVF_gc  0x46
+#define DMA_CH_TRIGSRC_SPIC_gc  0x4A
+#define DMA_CH_TRIGSRC_TCD0_OVF_gc  0x60
+#define DMA_CH_TRIGSRC_TCD1_OVF_gc  0x66
+#define DMA_CH_TRIGSRC_SPID_gc  0x6A
+#define DMA_CH_TRIGSRC_TCE0_OVF_gc  0x80
+#define DMA_CH_TRIGSRC_TCE1_OVF_gc  0x86
+#define DMA_CH_TRIGSRC_SPIE_gc  0x8A
+#define DMA_CH_TRIGSRC_TCF0_OVF_gc  0xA0
+#define DMA_CH_TRIGSRC_TCF1_OVF_gc  0xA6
+#define DMA_CH_TRIGSRC_SPIF_gc  0xAA
+//@}
+
+#endif
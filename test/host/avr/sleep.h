@@ -0,0 +1,20 @@
+/** @file
+ * @brief Host emulation of avr/sleep.h
+ *
+ * Tests set \ref host_sleep_cpu_hook to simulate time spent sleeping, until
+ * the next interrupt.
+ */
+#ifndef HOST_AVR_SLEEP_H__
+#define HOST_AVR_SLEEP_H__
+
+/// Function called by sleep_cpu(), if set
+void (*host_sleep_cpu_hook)(void) __attribute__((weak));
+
+#define SLEEP_MODE_IDLE  0
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()  do { if(host_sleep_cpu_hook) { host_sleep_cpu_hook(); } } while(0)
+
+#endif
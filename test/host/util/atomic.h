@@ -0,0 +1,16 @@
+/** @file
+ * @brief Host emulation of util/atomic.h
+ *
+ * Interrupts are simulated by tests, blocks are always atomic.
+ */
+#ifndef HOST_UTIL_ATOMIC_H__
+#define HOST_UTIL_ATOMIC_H__
+
+#include <avr/interrupt.h>
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type)  for(int host__atomic__ = 1; host__atomic__; host__atomic__ = 0)
+#define NONATOMIC_BLOCK(type)  ATOMIC_BLOCK(type)
+
+#endif
@@ -0,0 +1,12 @@
+/** @file
+ * @brief Host emulation of util/delay.h
+ *
+ * Delays are ignored, emulated hardware is always ready.
+ */
+#ifndef HOST_UTIL_DELAY_H__
+#define HOST_UTIL_DELAY_H__
+
+#define _delay_ms(ms)
+#define _delay_us(us)
+
+#endif
@@ -0,0 +1,10 @@
+/** @file
+ * @brief Host emulation of util/parity.h
+ */
+#ifndef HOST_UTIL_PARITY_H__
+#define HOST_UTIL_PARITY_H__
+
+/// Return 1 if \e val has an odd number of bits set
+#define parity_even_bit(val)  __builtin_parity((uint8_t)(val))
+
+#endif
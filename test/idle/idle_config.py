@@ -0,0 +1,7 @@
+# Idle tasks configuration for host tests
+
+set_min_period(100)
+add_task('periodic', 700, 1)
+add_deferred('work')
+# wake up with the uptime timer, on another channel
+enable_sleep('C0', 'B', 100000)
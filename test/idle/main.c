@@ -0,0 +1,246 @@
+/** @file
+ * @brief Host test of idle sleep and CPU load
+ *
+ * Time only advances when the test moves the counter of the emulated timer.
+ * Compare matches reached meanwhile execute the channel ISR, in order.
+ * Sleeping advances the counter to the next enabled compare match, which
+ * wakes up the CPU.
+ *
+ * A periodic task simulates its execution time. Its executions must not be
+ * late, including when an interrupt runs just before the wake-up compare is
+ * armed. The measured CPU load is checked against the simulated busy time.
+ */
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <timer/uptime.h>
+#include <idle/idle.h>
+
+void TCC0_CCA_vect(void);
+void TCC0_CCB_vect(void);
+
+/// Timer ticks per microsecond
+#define TICKS_PER_US  4
+/// Simulated execution time of the idle loop, without tasks, in ticks
+#define IDLE_LOOP_TICKS  8
+/// Simulated execution time of the periodic task, in ticks
+#define TASK_TICKS  (100 * TICKS_PER_US)
+/// Periodic task period, in microseconds
+#define TASK_PERIOD_US  700
+/// Allowed task lateness, in microseconds
+#define MAX_LATENESS_US  3
+
+/// Uptime of the next expected task execution
+static uint32_t task_expected;
+/// Maximum lateness of task executions
+static uint32_t task_max_lateness;
+/// Number of task executions
+static uint32_t task_count;
+/// Number of sleeps
+static uint32_t sleep_count;
+/// Ticks spent out of sleep
+static uint32_t busy_ticks;
+/// Ticks spent sleeping
+static uint32_t sleep_ticks;
+
+
+/// Return ticks to the next enabled compare match, set its channel index
+static uint32_t sim_next_match(uint8_t *ich)
+{
+  uint32_t best = UINT32_MAX;
+  for(uint8_t i=0; i<2; i++) {
+    if(TCC0.INTCTRLB & (3 << 2*i)) {
+      const uint16_t d = (&TCC0.CCA)[i] - TCC0.CNT;
+      const uint32_t ticks = d ? d : 0x10000;
+      if(ticks < best) {
+        best = ticks;
+        *ich = i;
+      }
+    }
+  }
+  return best;
+}
+
+/// Execute the ISR of a channel
+static void sim_match(uint8_t ich)
+{
+  if(ich == 0) {
+    TCC0_CCA_vect();
+  } else {
+    TCC0_CCB_vect();
+  }
+}
+
+/// Advance time, execute ISRs of reached compare matches
+static void sim_advance(uint32_t ticks)
+{
+  busy_ticks += ticks;
+  for(;;) {
+    uint8_t ich;
+    const uint32_t d = sim_next_match(&ich);
+    if(d > ticks) {
+      TCC0.CNT += ticks;
+      return;
+    }
+    TCC0.CNT += d;
+    ticks -= d;
+    sim_match(ich);
+  }
+}
+
+/// Sleep until the next interrupt
+static void sim_sleep(void)
+{
+  uint8_t ich;
+  const uint32_t d = sim_next_match(&ich);
+  sleep_count++;
+  sleep_ticks += d;
+  TCC0.CNT += d;
+  sim_match(ich);
+}
+
+static void task(void)
+{
+  const uint32_t now = uptime_us_precise();
+  const uint32_t lateness = now - task_expected;
+  if(lateness > task_max_lateness) {
+    task_max_lateness = lateness;
+  }
+  task_expected += TASK_PERIOD_US;
+  task_count++;
+  sim_advance(TASK_TICKS);
+}
+
+/// Run idle loop until given uptime
+static void run_until(uint32_t end)
+{
+  while((int32_t)(uptime_us_precise() - end) < 0) {
+    idle();
+    sim_advance(IDLE_LOOP_TICKS);
+  }
+}
+
+/// Start the periodic task, reset statistics
+static void start_task(void)
+{
+  task_expected = uptime_us_precise();
+  idle_set_callback(periodic, task);
+  task_max_lateness = 0;
+  task_count = 0;
+  sleep_count = 0;
+  busy_ticks = 0;
+  sleep_ticks = 0;
+}
+
+
+/// Task deadlines are met while sleeping, load is measured
+static int test_sleep(void)
+{
+  start_task();
+  run_until(uptime_us() + 300000);
+  idle_set_callback(periodic, 0);
+
+  const unsigned expected_load = (busy_ticks * 100 + (busy_ticks + sleep_ticks) / 2) / (busy_ticks + sleep_ticks);
+  printf("sleep: %lu task executions, %lu sleeps, max lateness %lu us\n",
+         (unsigned long)task_count, (unsigned long)sleep_count, (unsigned long)task_max_lateness);
+  printf("  load: %u%%, simulated %u%%\n", idle_cpu_load(), expected_load);
+
+  int ret = 0;
+  if(task_count < 300000 / TASK_PERIOD_US) {
+    printf("FAIL: missing task executions\n");
+    ret = 1;
+  }
+  if(task_max_lateness > MAX_LATENESS_US) {
+    printf("FAIL: late task execution\n");
+    ret = 1;
+  }
+  if(sleep_count < task_count) {
+    printf("FAIL: CPU did not sleep between executions\n");
+    ret = 1;
+  }
+  const unsigned load = idle_cpu_load();
+  if(load + 1 < expected_load || load > expected_load + 1) {
+    printf("FAIL: unexpected CPU load\n");
+    ret = 1;
+  }
+  return ret;
+}
+
+
+/// Ticks the interrupt simulated before cli() exceeds the task deadline by
+static int32_t cli_overshoot;
+/// True if a work is posted by the interrupt simulated before cli()
+static bool cli_post;
+
+/// Simulate an interrupt executed just before the wake-up is armed
+static void cli_interrupt(void)
+{
+  host_cli_hook = 0;
+  const int32_t remaining = (task_expected - uptime_us_precise()) * TICKS_PER_US;
+  sim_advance(remaining + cli_overshoot);
+  if(cli_post) {
+    idle_post(work);
+  }
+}
+
+static void work(void) {}
+
+/// An interrupt delays the sleep, close to or past the next deadline
+static int test_late_interrupt(void)
+{
+  static const int32_t overshoots[] = { -400, -20, -4, -1, 0, 1, 5, 50 };
+  int ret = 0;
+  idle_set_deferred_callback(work, work);
+  for(unsigned i=0; i<sizeof(overshoots)/sizeof(*overshoots); i++) {
+    start_task();
+    run_until(uptime_us() + 10000);
+    // next idle() call sleeps until the next execution
+    cli_overshoot = overshoots[i];
+    cli_post = false;
+    task_max_lateness = 0;
+    host_cli_hook = cli_interrupt;
+    run_until(uptime_us() + 10000);
+    idle_set_callback(periodic, 0);
+
+    const int32_t allowed = MAX_LATENESS_US + (cli_overshoot > 0 ? cli_overshoot / TICKS_PER_US : 0);
+    printf("late interrupt: overshoot %ld ticks, max lateness %lu us\n",
+           (long)cli_overshoot, (unsigned long)task_max_lateness);
+    if(task_max_lateness > (uint32_t)allowed) {
+      printf("FAIL: late task execution\n");
+      ret = 1;
+    }
+  }
+
+  // a work posted before cli() prevents the sleep
+  start_task();
+  run_until(uptime_us() + 10000);
+  cli_overshoot = -400;
+  cli_post = true;
+  host_cli_hook = cli_interrupt;
+  const uint32_t count = sleep_count;
+  idle();
+  idle_set_callback(periodic, 0);
+  if(host_cli_hook) {
+    printf("FAIL: sleep not attempted\n");
+    host_cli_hook = 0;
+    ret = 1;
+  } else if(sleep_count != count) {
+    printf("FAIL: sleep with a pending work\n");
+    ret = 1;
+  }
+  return ret;
+}
+
+
+int main(void)
+{
+  host_sleep_cpu_hook = sim_sleep;
+  timer_init();
+  uptime_init();
+
+  int ret = 0;
+  ret |= test_sleep();
+  ret |= test_late_interrupt();
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
@@ -0,0 +1,13 @@
+/**
+ * @file
+ * @brief Timer configuration for host tests
+ */
+
+/// 4 ticks per microsecond
+#define TIMER_PRESCALER_DIV  8
+
+#define TIMERC0_ENABLED
+
+#define UPTIME_TIMER  C0
+#define UPTIME_TIMER_CHANNEL  'A'
+#define UPTIME_TICK_US  1000
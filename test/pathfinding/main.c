@@ -0,0 +1,1051 @@
+/** @file
+ * @brief Host tests and benchmarks of the pathfinding module
+ *
+ * Tests are run in order, or only those given on the command line.
+ * Searches are checked against reference implementations, timings are
+ * measured on the host and only meant to compare implementations.
+ *
+ * The benchmark test compares search expansions to the baseline stored in
+ * BASELINE_FILE. Times depend on the host and are only compared with
+ * `make benchmark`. Update the baseline with `make update-baseline` after an
+ * intended change, or on another machine before comparing times.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pathfinding/pathfinding.h>
+
+/// Number of random searches per graph
+#define SEARCH_COUNT  2000
+/// Number of timed runs of benchmark searches, the fastest one is kept
+#define BENCHMARK_RUNS  5
+
+/// Benchmark baseline, in the test directory
+#define BASELINE_FILE  "benchmark_baseline.txt"
+/// Allowed increase of expansions per search over the baseline, in percent
+#define BASELINE_EXPANSIONS_THRESHOLD  5
+/// Allowed increase of search time over the baseline, in percent, with --benchmark
+#define BASELINE_TIME_THRESHOLD  100
+
+#define GRAPH_SETTER(name) \
+  static void set_##name(pathfinding_t *finder) { pathfinding_set_nodes(finder, name); }
+GRAPH_SETTER(random32)
+GRAPH_SETTER(random64)
+GRAPH_SETTER(random128)
+GRAPH_SETTER(random250)
+GRAPH_SETTER(field)
+#undef GRAPH_SETTER
+
+/// Test graph
+typedef struct {
+  const char *name;
+  void (*set)(pathfinding_t *finder);
+} test_graph_t;
+
+#define TEST_GRAPH(name)  { #name, set_##name }
+
+static const test_graph_t random_graphs[] = {
+  TEST_GRAPH(random32),
+  TEST_GRAPH(random64),
+  TEST_GRAPH(random128),
+  TEST_GRAPH(random250),
+};
+
+static const test_graph_t benchmark_graphs[] = {
+  TEST_GRAPH(random32),
+  TEST_GRAPH(random64),
+  TEST_GRAPH(random128),
+  TEST_GRAPH(random250),
+  TEST_GRAPH(field),
+};
+
+/// Write benchmark results to the baseline, instead of comparing them
+static bool update_baseline;
+/// Compare benchmark times to the baseline, not only expansions
+static bool compare_times;
+
+#define ARRAY_SIZE(a)  (sizeof(a) / sizeof(*(a)))
+/// Get a bit of blocked nodes or vertices, as the module
+#define BITMAP_GET(bitmap, i)  (((bitmap)[(i)/8] >> ((i)%8)) & 1)
+
+
+/// Pseudo-random generator, for reproducible runs
+static uint32_t lcg_state = 1;
+static uint32_t lcg_rand(uint32_t n)
+{
+  lcg_state = lcg_state * 1103515245 + 12345;
+  return (lcg_state >> 8) % n;
+}
+
+/// Return a monotonic time, in microseconds
+static double now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+/// Initialize a path finder on a graph, without obstacles
+static void finder_init(pathfinding_t *finder, const test_graph_t *graph)
+{
+  memset(finder, 0, sizeof(*finder));
+  graph->set(finder);
+  finder->landmarks = NULL;
+  finder->slot_length = 1;
+  pathfinding_set_obstacles(finder, NULL, 0);
+}
+
+/// Set a random circle or rectangle obstacle
+static void random_obstacle(pathfinding_obstacle_t *o)
+{
+  memset(o, 0, sizeof(*o));
+  o->x = lcg_rand(3000);
+  o->y = lcg_rand(2000);
+  if(lcg_rand(2)) {
+    o->shape = PATHFINDING_OBSTACLE_RECTANGLE;
+    o->dx = 50 + lcg_rand(200);
+    o->dy = 50 + lcg_rand(200);
+  } else {
+    o->shape = PATHFINDING_OBSTACLE_CIRCLE;
+    o->r = 50 + lcg_rand(200);
+  }
+}
+
+/// Return true if blocked nodes and vertices of a finder are up-to-date
+static bool finder_blocked_valid(const pathfinding_t *finder)
+{
+  static pathfinding_t full;
+  full = *finder;
+  pathfinding_update_obstacles(&full);
+  return memcmp(full.blocked_nodes, finder->blocked_nodes, sizeof(full.blocked_nodes)) == 0 &&
+      memcmp(full.blocked_vertices, finder->blocked_vertices, sizeof(full.blocked_vertices)) == 0;
+}
+
+/// Integer square root of a distance, as used by the module heuristic
+static uint32_t distance(const pathfinding_node_t *a, const pathfinding_node_t *b, bool round_up)
+{
+  const int32_t dx = a->x - b->x;
+  const int32_t dy = a->y - b->y;
+  uint32_t c = dx*dx + dy*dy;
+  uint32_t res = 0;
+  uint32_t bit = 1UL << 30;
+  while(bit > c) {
+    bit >>= 2;
+  }
+  while(bit != 0) {
+    if(c >= res + bit) {
+      c -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return round_up && c ? res + 1 : res;
+}
+
+
+/// Cost of a vertex, computed from node positions as the generated costs
+static uint32_t computed_cost(const pathfinding_t *finder, pathfinding_index_t a, pathfinding_index_t b)
+{
+  return distance(&finder->nodes[a], &finder->nodes[b], true);
+}
+
+/// Reference search result
+typedef struct {
+  uint32_t cost;  ///< path cost, UINT32_MAX if no path is found
+  uint32_t expansions;  ///< number of expanded nodes
+  unsigned path_size;
+  pathfinding_index_t path[PATHFINDING_MAX_NODES_SIZE];
+} reference_result_t;
+
+/** @brief Reference A* search, with a linear scan of the open set
+ *
+ * This is the search used before the binary heap open set. Blocked nodes and
+ * vertices are ignored. Vertex costs are read from the graph, or computed
+ * from node positions if \e computed is true, as before generated costs.
+ */
+static void linear_search(const pathfinding_t *finder, pathfinding_index_t start, pathfinding_index_t goal,
+                          bool computed, reference_result_t *result)
+{
+  enum { PENDING, OPEN, CLOSED } state[PATHFINDING_MAX_NODES_SIZE];
+  uint32_t costs[PATHFINDING_MAX_NODES_SIZE];
+  uint32_t total_costs[PATHFINDING_MAX_NODES_SIZE];
+  pathfinding_index_t previous[PATHFINDING_MAX_NODES_SIZE];
+  const pathfinding_node_t *nodes = finder->nodes;
+  for(unsigned i=0; i<finder->nodes_size; i++) {
+    state[i] = PENDING;
+    costs[i] = UINT32_MAX;
+  }
+  state[start] = OPEN;
+  costs[start] = 0;
+  total_costs[start] = distance(&nodes[start], &nodes[goal], false);
+  previous[start] = PATHFINDING_INDEX_NONE;
+  result->cost = UINT32_MAX;
+  result->path_size = 0;
+
+  for(;;) {
+    unsigned current = PATHFINDING_INDEX_NONE;
+    uint32_t min_cost = UINT32_MAX;
+    for(unsigned i=0; i<finder->nodes_size; i++) {
+      if(state[i] == OPEN && total_costs[i] < min_cost) {
+        min_cost = total_costs[i];
+        current = i;
+      }
+    }
+    if(current == PATHFINDING_INDEX_NONE) {
+      return;
+    }
+    result->expansions++;
+    if(current == goal) {
+      break;
+    }
+    state[current] = CLOSED;
+    for(uint16_t i=finder->offsets[current]; i<finder->offsets[current+1]; i++) {
+      const pathfinding_index_t neighbor = finder->neighbors[i];
+      if(state[neighbor] == CLOSED) {
+        continue;
+      }
+      const uint32_t cost = costs[current] +
+          (computed ? computed_cost(finder, current, neighbor) : finder->costs[i]);
+      if(cost < costs[neighbor]) {
+        state[neighbor] = OPEN;
+        previous[neighbor] = current;
+        costs[neighbor] = cost;
+        total_costs[neighbor] = cost + distance(&nodes[neighbor], &nodes[goal], false);
+      }
+    }
+  }
+
+  result->cost = costs[goal];
+  for(unsigned i=goal; i!=PATHFINDING_INDEX_NONE; i=previous[i]) {
+    result->path_size++;
+  }
+  unsigned k = result->path_size;
+  for(unsigned i=goal; i!=PATHFINDING_INDEX_NONE; i=previous[i]) {
+    result->path[--k] = i;
+  }
+}
+
+
+/** @brief Reference Dijkstra search, avoiding blocked nodes and vertices
+ *
+ * @return The cost of the shortest path, UINT32_MAX if goal is not reachable.
+ */
+static uint32_t dijkstra_cost(const pathfinding_t *finder, pathfinding_index_t start, pathfinding_index_t goal)
+{
+  bool closed[PATHFINDING_MAX_NODES_SIZE] = { false };
+  uint32_t costs[PATHFINDING_MAX_NODES_SIZE];
+  for(unsigned i=0; i<finder->nodes_size; i++) {
+    costs[i] = UINT32_MAX;
+  }
+  if(BITMAP_GET(finder->blocked_nodes, start) || BITMAP_GET(finder->blocked_nodes, goal)) {
+    return UINT32_MAX;
+  }
+  costs[start] = 0;
+  for(;;) {
+    unsigned current = PATHFINDING_INDEX_NONE;
+    for(unsigned i=0; i<finder->nodes_size; i++) {
+      if(!closed[i] && costs[i] != UINT32_MAX && (current == PATHFINDING_INDEX_NONE || costs[i] < costs[current])) {
+        current = i;
+      }
+    }
+    if(current == PATHFINDING_INDEX_NONE || current == goal) {
+      return costs[goal];
+    }
+    closed[current] = true;
+    for(uint16_t i=finder->offsets[current]; i<finder->offsets[current+1]; i++) {
+      const pathfinding_index_t neighbor = finder->neighbors[i];
+      if(BITMAP_GET(finder->blocked_vertices, i) || BITMAP_GET(finder->blocked_nodes, neighbor)) {
+        continue;
+      }
+      if(costs[current] + finder->costs[i] < costs[neighbor]) {
+        costs[neighbor] = costs[current] + finder->costs[i];
+      }
+    }
+  }
+}
+
+
+/// Compare the heap open set to a linear scan, on random graphs
+static int test_open_set(void)
+{
+  int ret = 0;
+  printf("open set: %d random searches per graph\n", SEARCH_COUNT);
+  printf("  %-10s %5s  %10s %10s  %10s %10s\n", "graph", "nodes",
+         "heap exp.", "heap us", "linear exp.", "linear us");
+  for(unsigned k=0; k<ARRAY_SIZE(random_graphs); k++) {
+    static pathfinding_t finder;
+    finder_init(&finder, &random_graphs[k]);
+    pathfinding_index_t starts[SEARCH_COUNT], goals[SEARCH_COUNT];
+    uint32_t costs[SEARCH_COUNT];
+    for(unsigned i=0; i<SEARCH_COUNT; i++) {
+      starts[i] = lcg_rand(finder.nodes_size);
+      goals[i] = lcg_rand(finder.nodes_size);
+    }
+
+    const uint32_t expansions0 = finder.stats.expansions;
+    double t0 = now_us();
+    for(unsigned i=0; i<SEARCH_COUNT; i++) {
+      pathfinding_search(&finder, starts[i], goals[i]);
+      costs[i] = finder.path_cost;
+    }
+    const double heap_us = (now_us() - t0) / SEARCH_COUNT;
+    const uint32_t heap_expansions = finder.stats.expansions - expansions0;
+
+    uint32_t linear_expansions = 0;
+    unsigned mismatches = 0;
+    t0 = now_us();
+    for(unsigned i=0; i<SEARCH_COUNT; i++) {
+      reference_result_t result = { .expansions = 0 };
+      linear_search(&finder, starts[i], goals[i], false, &result);
+      linear_expansions += result.expansions;
+      if(result.cost != costs[i]) {
+        mismatches++;
+      }
+    }
+    const double linear_us = (now_us() - t0) / SEARCH_COUNT;
+
+    printf("  %-10s %5u  %10.1f %10.2f  %10.1f %10.2f\n", random_graphs[k].name, finder.nodes_size,
+           (double)heap_expansions / SEARCH_COUNT, heap_us,
+           (double)linear_expansions / SEARCH_COUNT, linear_us);
+    if(mismatches) {
+      printf("FAIL: %s: %u path costs differ from linear scan\n", random_graphs[k].name, mismatches);
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+
+/** @brief Compare generated vertex costs to costs computed at runtime
+ *
+ * Paths found using generated costs must be identical to paths found by
+ * computing costs from node positions. Time of a cost table lookup is
+ * compared to the integer square root it replaces.
+ */
+static int test_costs(void)
+{
+  int ret = 0;
+  printf("costs: %d random searches per graph\n", SEARCH_COUNT);
+  printf("  %-10s %8s  %12s %12s\n", "graph", "vertices", "table ns", "computed ns");
+  for(unsigned k=0; k<ARRAY_SIZE(random_graphs); k++) {
+    static pathfinding_t finder;
+    finder_init(&finder, &random_graphs[k]);
+    const uint16_t vertices_size = finder.offsets[finder.nodes_size];
+
+    unsigned mismatches = 0;
+    for(unsigned i=0; i<SEARCH_COUNT; i++) {
+      const pathfinding_index_t start = lcg_rand(finder.nodes_size);
+      const pathfinding_index_t goal = lcg_rand(finder.nodes_size);
+      pathfinding_search(&finder, start, goal);
+      reference_result_t result = { .expansions = 0 };
+      linear_search(&finder, start, goal, true, &result);
+      if(result.cost != finder.path_cost || result.path_size != finder.path_size ||
+         memcmp(result.path, finder.path, finder.path_size * sizeof(*finder.path)) != 0) {
+        mismatches++;
+      }
+    }
+
+    // relax all vertices of the graph, many times
+    const unsigned rounds = 2000;
+    volatile uint32_t sink = 0;
+    double t0 = now_us();
+    for(unsigned r=0; r<rounds; r++) {
+      uint32_t sum = 0;
+      for(uint16_t i=0; i<vertices_size; i++) {
+        sum += finder.costs[i];
+      }
+      sink += sum;
+    }
+    const double table_ns = (now_us() - t0) * 1e3 / rounds / vertices_size;
+    t0 = now_us();
+    for(unsigned r=0; r<rounds; r++) {
+      uint32_t sum = 0;
+      for(pathfinding_index_t a=0; a<finder.nodes_size; a++) {
+        for(uint16_t i=finder.offsets[a]; i<finder.offsets[a+1]; i++) {
+          sum += computed_cost(&finder, a, finder.neighbors[i]);
+        }
+      }
+      sink += sum;
+    }
+    const double computed_ns = (now_us() - t0) * 1e3 / rounds / vertices_size;
+    (void)sink;
+
+    printf("  %-10s %8u  %12.2f %12.2f\n", random_graphs[k].name, vertices_size, table_ns, computed_ns);
+    if(mismatches) {
+      printf("FAIL: %s: %u paths differ from paths with computed costs\n", random_graphs[k].name, mismatches);
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+
+/** @brief Check incremental obstacle updates against a full update
+ *
+ * Obstacles are set without an explicit update, then randomly added, moved
+ * and removed. Time of incremental updates is compared to full updates.
+ */
+static int test_obstacles(void)
+{
+  const unsigned changes = 2000;
+  static pathfinding_t finder;
+  finder_init(&finder, &random_graphs[ARRAY_SIZE(random_graphs)-1]);
+  pathfinding_obstacle_t obstacles[16];
+  uint8_t obstacles_size = 8;
+  for(uint8_t i=0; i<obstacles_size; i++) {
+    random_obstacle(&obstacles[i]);
+  }
+
+  // blocked state is updated by the search
+  pathfinding_set_obstacles(&finder, obstacles, obstacles_size);
+  pathfinding_search(&finder, 0, 1);
+  if(!finder_blocked_valid(&finder)) {
+    printf("FAIL: obstacles: blocked state not updated after pathfinding_set_obstacles()\n");
+    return 1;
+  }
+
+  unsigned errors = 0;
+  double incremental_us = 0;
+  for(unsigned n=0; n<changes; n++) {
+    const uint32_t action = lcg_rand(3);
+    double t0;
+    if(action == 0 && obstacles_size < ARRAY_SIZE(obstacles)) {
+      random_obstacle(&obstacles[obstacles_size]);
+      finder.obstacles_size = ++obstacles_size;
+      t0 = now_us();
+      pathfinding_obstacle_added(&finder, obstacles_size-1);
+    } else if(action == 1 && obstacles_size > 1) {
+      const uint8_t index = lcg_rand(obstacles_size);
+      const pathfinding_obstacle_t old = obstacles[index];
+      obstacles[index] = obstacles[--obstacles_size];
+      finder.obstacles_size = obstacles_size;
+      t0 = now_us();
+      pathfinding_obstacle_removed(&finder, &old);
+    } else {
+      const uint8_t index = lcg_rand(obstacles_size);
+      const pathfinding_obstacle_t old = obstacles[index];
+      obstacles[index].x += (int16_t)lcg_rand(201) - 100;
+      obstacles[index].y += (int16_t)lcg_rand(201) - 100;
+      t0 = now_us();
+      pathfinding_obstacle_moved(&finder, index, &old);
+    }
+    incremental_us += now_us() - t0;
+    if(!finder_blocked_valid(&finder)) {
+      errors++;
+    }
+  }
+
+  const double t0 = now_us();
+  for(unsigned n=0; n<changes; n++) {
+    pathfinding_update_obstacles(&finder);
+  }
+  const double full_us = now_us() - t0;
+
+  printf("obstacles: %u changes on %s, incremental %.2f us, full %.2f us\n",
+         changes, random_graphs[ARRAY_SIZE(random_graphs)-1].name,
+         incremental_us / changes, full_us / changes);
+  if(errors) {
+    printf("FAIL: %u incremental updates differ from a full update\n", errors);
+    return 1;
+  }
+  return 0;
+}
+
+
+/// Benchmark result of a graph, with a given number of random obstacles
+typedef struct {
+  char name[32];
+  double expansions;  ///< expansions per search
+  double us;  ///< time per search, in microseconds
+} benchmark_result_t;
+
+/// Read the benchmark baseline, return the number of results
+static unsigned baseline_read(benchmark_result_t *results, unsigned size)
+{
+  FILE *f = fopen(BASELINE_FILE, "r");
+  if(!f) {
+    return 0;
+  }
+  unsigned n = 0;
+  while(n < size && fscanf(f, "%31s %lf %lf", results[n].name, &results[n].expansions, &results[n].us) == 3) {
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+/** @brief Benchmark searches, compare them to the baseline
+ *
+ * Random searches are run on each graph, using its landmarks, without
+ * obstacles and with random obstacles. Path costs must be equal to the
+ * costs of a reference Dijkstra search. Expansions per search must not exceed
+ * the baseline by more than the allowed threshold.
+ *
+ * Time per search is only compared with --benchmark, since it depends on the
+ * host. It is the one of the fastest run, to be less sensitive to host load.
+ */
+static int test_benchmark(void)
+{
+  static const uint8_t densities[] = { 0, 4, 8 };
+  benchmark_result_t results[ARRAY_SIZE(benchmark_graphs) * ARRAY_SIZE(densities)];
+  benchmark_result_t baseline[ARRAY_SIZE(results)];
+  const unsigned baseline_size = update_baseline ? 0 : baseline_read(baseline, ARRAY_SIZE(baseline));
+  unsigned results_size = 0;
+  int ret = 0;
+  // same searches whichever tests are run
+  lcg_state = 1;
+
+  printf("benchmark: %d random searches per graph\n", SEARCH_COUNT);
+  printf("  %-16s %5s  %10s %10s  %10s %10s  %10s\n", "graph", "nodes",
+         "exp.", "base exp.", "us", "base us", "suboptimal");
+  for(unsigned k=0; k<ARRAY_SIZE(benchmark_graphs); k++) {
+    for(unsigned d=0; d<ARRAY_SIZE(densities); d++) {
+      static pathfinding_t finder;
+      memset(&finder, 0, sizeof(finder));
+      benchmark_graphs[k].set(&finder);
+      finder.slot_length = 1;
+      pathfinding_obstacle_t obstacles[8];
+      for(uint8_t i=0; i<densities[d]; i++) {
+        random_obstacle(&obstacles[i]);
+      }
+      pathfinding_set_obstacles(&finder, obstacles, densities[d]);
+      pathfinding_update_obstacles(&finder);
+
+      pathfinding_index_t starts[SEARCH_COUNT], goals[SEARCH_COUNT];
+      uint32_t costs[SEARCH_COUNT];
+      for(unsigned i=0; i<SEARCH_COUNT; i++) {
+        starts[i] = lcg_rand(finder.nodes_size);
+        goals[i] = lcg_rand(finder.nodes_size);
+      }
+      benchmark_result_t *result = &results[results_size++];
+      for(unsigned run=0; run<BENCHMARK_RUNS; run++) {
+        const uint32_t expansions0 = finder.stats.expansions;
+        const double t0 = now_us();
+        for(unsigned i=0; i<SEARCH_COUNT; i++) {
+          pathfinding_search(&finder, starts[i], goals[i]);
+          costs[i] = finder.path_cost;
+        }
+        const double us = (now_us() - t0) / SEARCH_COUNT;
+        if(run == 0) {
+          result->expansions = (double)(finder.stats.expansions - expansions0) / SEARCH_COUNT;
+          result->us = us;
+        } else if(us < result->us) {
+          result->us = us;
+        }
+      }
+      snprintf(result->name, sizeof(result->name), "%s/%u", benchmark_graphs[k].name, densities[d]);
+
+      unsigned suboptimal = 0;
+      for(unsigned i=0; i<SEARCH_COUNT; i++) {
+        if(costs[i] != dijkstra_cost(&finder, starts[i], goals[i])) {
+          suboptimal++;
+        }
+      }
+
+      const benchmark_result_t *base = NULL;
+      for(unsigned i=0; i<baseline_size; i++) {
+        if(strcmp(baseline[i].name, result->name) == 0) {
+          base = &baseline[i];
+        }
+      }
+      printf("  %-16s %5u  %10.1f %10.1f  %10.2f %10.2f  %10u\n", result->name, finder.nodes_size,
+             result->expansions, base ? base->expansions : 0, result->us, base ? base->us : 0, suboptimal);
+      if(suboptimal) {
+        printf("FAIL: %s: %u path costs differ from Dijkstra\n", result->name, suboptimal);
+        ret = 1;
+      }
+      if(update_baseline) {
+        continue;
+      } else if(!base) {
+        printf("FAIL: %s: not in baseline\n", result->name);
+        ret = 1;
+      } else if(result->expansions > base->expansions * (1 + BASELINE_EXPANSIONS_THRESHOLD / 100.)) {
+        printf("FAIL: %s: expansions regression\n", result->name);
+        ret = 1;
+      } else if(compare_times && result->us > base->us * (1 + BASELINE_TIME_THRESHOLD / 100.)) {
+        printf("FAIL: %s: time regression\n", result->name);
+        ret = 1;
+      }
+    }
+  }
+
+  if(update_baseline) {
+    FILE *f = fopen(BASELINE_FILE, "w");
+    if(!f) {
+      printf("FAIL: cannot write %s\n", BASELINE_FILE);
+      return 1;
+    }
+    for(unsigned i=0; i<results_size; i++) {
+      fprintf(f, "%s %.2f %.3f\n", results[i].name, results[i].expansions, results[i].us);
+    }
+    fclose(f);
+    printf("baseline written to %s\n", BASELINE_FILE);
+  }
+  return ret;
+}
+
+
+/// Add circles along a segment, as walls described before other shapes
+static void add_circle_chain(pathfinding_obstacle_t *obstacles, uint8_t *size,
+                             int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t r, int16_t step)
+{
+  const int32_t length = distance(&(pathfinding_node_t){ x0, y0 }, &(pathfinding_node_t){ x1, y1 }, true);
+  const int32_t count = length / step + 1;
+  for(int32_t i=0; i<=count; i++) {
+    pathfinding_obstacle_t *o = &obstacles[(*size)++];
+    memset(o, 0, sizeof(*o));
+    o->x = x0 + (x1 - x0) * i / count;
+    o->y = y0 + (y1 - y0) * i / count;
+    o->r = r;
+  }
+}
+
+/** @brief Compare obstacle shapes to chains of circles, on the field graph
+ *
+ * Walls and opponents are described using segments and rectangles, then
+ * approximated using circles. Shapes must need fewer obstacles and update
+ * blocked vertices faster.
+ */
+static int test_shapes(void)
+{
+  const unsigned rounds = 2000;
+  static pathfinding_t finder;
+  pathfinding_obstacle_t shapes[] = {
+    // opponents
+    { .x = 800, .y = 1000, .shape = PATHFINDING_OBSTACLE_RECTANGLE, .dx = 150, .dy = 150 },
+    { .x = 2200, .y = 1200, .shape = PATHFINDING_OBSTACLE_RECTANGLE, .dx = 150, .dy = 150 },
+    // walls
+    { .x = 1500, .y = 200, .shape = PATHFINDING_OBSTACLE_SEGMENT, .dx = 0, .dy = 500 },
+    { .x = 700, .y = 300, .shape = PATHFINDING_OBSTACLE_SEGMENT, .dx = 400, .dy = 0 },
+    { .x = 2500, .y = 1500, .shape = PATHFINDING_OBSTACLE_RECTANGLE, .dx = 20, .dy = 300 },
+  };
+  static pathfinding_obstacle_t circles[64];
+  uint8_t circles_size = 0;
+  for(uint8_t i=0; i<2; i++) {
+    circles[circles_size++] = (pathfinding_obstacle_t){ .x = shapes[i].x, .y = shapes[i].y, .r = 212 };
+  }
+  add_circle_chain(circles, &circles_size, 1500, 200, 1500, 700, 20, 30);
+  add_circle_chain(circles, &circles_size, 700, 300, 1100, 300, 20, 30);
+  add_circle_chain(circles, &circles_size, 2500, 1200, 2500, 1800, 28, 40);
+
+  const test_graph_t *graph = &benchmark_graphs[ARRAY_SIZE(benchmark_graphs)-1];
+  finder_init(&finder, graph);
+  const uint16_t vertices_size = finder.offsets[finder.nodes_size];
+  double us[2];
+  unsigned blocked[2];
+  for(unsigned k=0; k<2; k++) {
+    if(k == 0) {
+      pathfinding_set_obstacles(&finder, shapes, ARRAY_SIZE(shapes));
+    } else {
+      pathfinding_set_obstacles(&finder, circles, circles_size);
+    }
+    const double t0 = now_us();
+    for(unsigned r=0; r<rounds; r++) {
+      pathfinding_update_obstacles(&finder);
+    }
+    us[k] = (now_us() - t0) / rounds;
+    blocked[k] = 0;
+    for(uint16_t i=0; i<vertices_size; i++) {
+      blocked[k] += BITMAP_GET(finder.blocked_vertices, i);
+    }
+  }
+
+  printf("shapes: %s, %u vertices\n", graph->name, vertices_size);
+  printf("  %-8s %9s %8s %10s %14s\n", "", "obstacles", "blocked", "update us", "ns per vertex");
+  printf("  %-8s %9u %8u %10.2f %14.1f\n", "shapes", (unsigned)ARRAY_SIZE(shapes), blocked[0], us[0], us[0] * 1e3 / vertices_size);
+  printf("  %-8s %9u %8u %10.2f %14.1f\n", "circles", circles_size, blocked[1], us[1], us[1] * 1e3 / vertices_size);
+  if(us[0] >= us[1]) {
+    printf("FAIL: shapes are not faster than circles\n");
+    return 1;
+  }
+  return 0;
+}
+
+/// Return the sum of vertex costs of the finder path, UINT32_MAX if a vertex is not usable
+static uint32_t path_edges_cost(const pathfinding_t *finder)
+{
+  uint32_t cost = 0;
+  for(unsigned k=1; k<finder->path_size; k++) {
+    const pathfinding_index_t a = finder->path[k-1];
+    const pathfinding_index_t b = finder->path[k];
+    uint16_t i;
+    for(i=finder->offsets[a]; i<finder->offsets[a+1]; i++) {
+      if(finder->neighbors[i] == b) {
+        break;
+      }
+    }
+    if(i == finder->offsets[a+1] || BITMAP_GET(finder->blocked_vertices, i) ||
+       BITMAP_GET(finder->blocked_nodes, b)) {
+      return UINT32_MAX;
+    }
+    cost += finder->costs[i];
+  }
+  return cost;
+}
+
+/** @brief Compare incremental searches to full searches
+ *
+ * Start moves along the found path, or to a random neighbor, while obstacles
+ * are randomly added, moved and removed. Each incremental search must find a
+ * path with the cost of a full search, and this cost must be the sum of the
+ * vertex costs of the path. Landmarks are used, to check their consistency.
+ *
+ * Replans after a small obstacle move must expand fewer nodes and take less
+ * time than full searches.
+ */
+static int test_dstar(void)
+{
+  const unsigned queries = 2000;
+  static pathfinding_t finder;
+  static pathfinding_dstar_t dstar;
+  finder_init(&finder, &random_graphs[ARRAY_SIZE(random_graphs)-1]);
+  finder.landmarks = &random250_landmarks;
+  pathfinding_obstacle_t obstacles[16];
+  uint8_t obstacles_size = 4;
+  for(uint8_t i=0; i<obstacles_size; i++) {
+    random_obstacle(&obstacles[i]);
+  }
+  pathfinding_set_obstacles(&finder, obstacles, obstacles_size);
+
+  unsigned errors = 0;
+  unsigned found = 0;
+  unsigned replans = 0;
+  uint32_t dstar_expansions = 0, full_expansions = 0;
+  double dstar_us = 0, full_us = 0;
+  pathfinding_index_t start = 0;
+  pathfinding_index_t goal = 0;
+  for(unsigned n=0; n<queries; n++) {
+    bool init = false;
+    bool replan = false;
+    if(start == goal || lcg_rand(50) == 0) {
+      start = lcg_rand(finder.nodes_size);
+      goal = lcg_rand(finder.nodes_size);
+      pathfinding_dstar_init(&dstar, &finder, goal);
+      init = true;
+    } else if(finder.path_size > 1) {
+      start = finder.path[1];
+    } else {
+      const uint16_t k0 = finder.offsets[start];
+      const uint16_t k1 = finder.offsets[start+1];
+      if(k1 > k0) {
+        start = finder.neighbors[k0 + lcg_rand(k1 - k0)];
+      }
+    }
+
+    const uint32_t action = lcg_rand(4);
+    if(action == 0 && obstacles_size < ARRAY_SIZE(obstacles)) {
+      random_obstacle(&obstacles[obstacles_size]);
+      finder.obstacles_size = ++obstacles_size;
+      pathfinding_obstacle_added(&finder, obstacles_size-1);
+    } else if(action == 1 && obstacles_size > 1) {
+      const uint8_t index = lcg_rand(obstacles_size);
+      const pathfinding_obstacle_t old = obstacles[index];
+      obstacles[index] = obstacles[--obstacles_size];
+      finder.obstacles_size = obstacles_size;
+      pathfinding_obstacle_removed(&finder, &old);
+    } else if(action == 2) {
+      // first search after initialization is not a replan
+      replan = !init;
+      const uint8_t index = lcg_rand(obstacles_size);
+      const pathfinding_obstacle_t old = obstacles[index];
+      obstacles[index].x += (int16_t)lcg_rand(201) - 100;
+      obstacles[index].y += (int16_t)lcg_rand(201) - 100;
+      pathfinding_obstacle_moved(&finder, index, &old);
+    }
+
+    const uint32_t expansions0 = finder.stats.expansions;
+    double t0 = now_us();
+    pathfinding_dstar_search(&dstar, start);
+    const double dstar_dt = now_us() - t0;
+    const uint32_t expansions1 = finder.stats.expansions;
+    const unsigned dstar_size = finder.path_size;
+    const uint32_t dstar_cost = finder.path_cost;
+    const uint32_t edges_cost = dstar_size ? path_edges_cost(&finder) : 0;
+    static pathfinding_index_t dstar_path[PATHFINDING_MAX_PATH_SIZE];
+    memcpy(dstar_path, finder.path, sizeof(dstar_path));
+    t0 = now_us();
+    pathfinding_search(&finder, start, goal);
+    const double full_dt = now_us() - t0;
+    if(replan) {
+      // obstacle epoch changed, the full search is not cached
+      replans++;
+      dstar_expansions += expansions1 - expansions0;
+      full_expansions += finder.stats.expansions - expansions1;
+      dstar_us += dstar_dt;
+      full_us += full_dt;
+    }
+    if((dstar_size == 0) != (finder.path_size == 0) ||
+       (dstar_size && (dstar_cost != finder.path_cost || edges_cost != dstar_cost))) {
+      if(errors < 5) {
+        printf("  query %u, %u to %u: incremental cost %lu (path %lu), full cost %lu\n",
+               n, start, goal, dstar_size ? (unsigned long)dstar_cost : 0, (unsigned long)edges_cost,
+               finder.path_size ? (unsigned long)finder.path_cost : 0);
+      }
+      errors++;
+    }
+    found += dstar_size != 0;
+    // next start moves along the incremental path
+    finder.path_size = dstar_size;
+    memcpy(finder.path, dstar_path, sizeof(dstar_path));
+  }
+
+  printf("dstar: %u queries on %s, %u paths found\n",
+         queries, random_graphs[ARRAY_SIZE(random_graphs)-1].name, found);
+  printf("  %u replans after a small move: incremental %.1f expansions %.2f us, full %.1f expansions %.2f us\n",
+         replans, (double)dstar_expansions / replans, dstar_us / replans,
+         (double)full_expansions / replans, full_us / replans);
+  int ret = 0;
+  if(errors) {
+    printf("FAIL: %u incremental searches differ from a full search\n", errors);
+    ret = 1;
+  }
+  if(dstar_expansions >= full_expansions || dstar_us >= full_us) {
+    printf("FAIL: incremental replans are not cheaper than full searches\n");
+    ret = 1;
+  }
+  return ret;
+}
+
+
+/// Check searches between positions: blocked start and direct paths
+static int test_positions(void)
+{
+  static pathfinding_t finder;
+  finder_init(&finder, &random_graphs[ARRAY_SIZE(random_graphs)-1]);
+  pathfinding_obstacle_t obstacles[2] = {
+    { .x = 1000, .y = 1000, .r = 100 },
+    { .x = 1500, .y = 1000, .shape = PATHFINDING_OBSTACLE_RECTANGLE, .dx = 20, .dy = 500 },
+  };
+  pathfinding_set_obstacles(&finder, obstacles, ARRAY_SIZE(obstacles));
+  int ret = 0;
+
+  if(pathfinding_search_xy(&finder, 1000, 1050, 300, 300, 400) != PATHFINDING_FAILED) {
+    printf("FAIL: positions: search from a blocked start did not fail\n");
+    ret = 1;
+  }
+  if(pathfinding_search_xy(&finder, 300, 300, 1000, 1050, 400) != PATHFINDING_FAILED) {
+    printf("FAIL: positions: search to a blocked goal did not fail\n");
+    ret = 1;
+  }
+  if(pathfinding_search_xy(&finder, 300, 300, 600, 700, 400) != PATHFINDING_FOUND ||
+     !finder.path_direct || finder.path_size != 0 || finder.path_cost != 500) {
+    printf("FAIL: positions: direct path not reported\n");
+    ret = 1;
+  }
+  const pathfinding_status_t status = pathfinding_search_xy(&finder, 1400, 1000, 1600, 1000, 400);
+  if(finder.path_direct || (status == PATHFINDING_FOUND) != (finder.path_size != 0)) {
+    printf("FAIL: positions: path through nodes reported as direct\n");
+    ret = 1;
+  }
+  printf("positions: around a wall, %s, %u nodes, cost %lu\n",
+         status == PATHFINDING_FOUND ? "found" : "not found", finder.path_size,
+         (unsigned long)finder.path_cost);
+  return ret;
+}
+
+
+/// Check that cached results can be published as reservations
+static int test_cache(void)
+{
+  static pathfinding_t finder;
+  finder_init(&finder, &random_graphs[ARRAY_SIZE(random_graphs)-1]);
+  finder.slot_length = 100;
+  pathfinding_reservation_t searched[PATHFINDING_MAX_PATH_SIZE];
+  pathfinding_reservation_t cached[PATHFINDING_MAX_PATH_SIZE];
+  unsigned hits = 0;
+  unsigned errors = 0;
+  for(unsigned i=0; i<SEARCH_COUNT; i++) {
+    const pathfinding_index_t start = lcg_rand(finder.nodes_size);
+    const pathfinding_index_t goal = lcg_rand(finder.nodes_size);
+    pathfinding_search(&finder, start, goal);
+    const uint8_t searched_size = pathfinding_reserve_path(&finder, searched, ARRAY_SIZE(searched));
+    const pathfinding_status_t status = finder.status;
+    const uint32_t cost = finder.path_cost;
+    // another search, then the cached one
+    pathfinding_search(&finder, goal, start);
+    const uint32_t hits0 = finder.stats.cache_hits;
+    pathfinding_search(&finder, start, goal);
+    hits += finder.stats.cache_hits - hits0;
+    const uint8_t cached_size = pathfinding_reserve_path(&finder, cached, ARRAY_SIZE(cached));
+    if(finder.start != start || finder.status != status || finder.path_cost != cost ||
+       cached_size != searched_size || memcmp(cached, searched, cached_size * sizeof(*cached)) != 0) {
+      errors++;
+    }
+  }
+  printf("cache: %d searches, %u cache hits\n", SEARCH_COUNT, hits);
+  if(hits != SEARCH_COUNT) {
+    printf("FAIL: cached results not used\n");
+    return 1;
+  }
+  if(errors) {
+    printf("FAIL: %u cached results differ from searched ones\n", errors);
+    return 1;
+  }
+  return 0;
+}
+
+/** @brief Check resumable searches in workspaces sized for each graph
+ *
+ * Searches are run a few expansions at a time. Node-to-node and multi-goal
+ * path costs are compared to Dijkstra, as well as costs of all goals.
+ * Workspace is followed by a guard, which must not be overwritten.
+ */
+static int test_workspace(void)
+{
+  enum { GUARD_SIZE = 16, GOALS_SIZE = 3 };
+  static pathfinding_workspace_t workspace[PATHFINDING_WORKSPACE_SIZE(PATHFINDING_MAX_NODES_SIZE) + GUARD_SIZE];
+  unsigned errors = 0;
+  printf("workspace: %d stepped searches per graph\n", SEARCH_COUNT);
+  for(unsigned k=0; k<ARRAY_SIZE(random_graphs); k++) {
+    static pathfinding_t finder;
+    finder_init(&finder, &random_graphs[k]);
+    const size_t size = PATHFINDING_WORKSPACE_SIZE(finder.nodes_size);
+    for(size_t i=0; i<GUARD_SIZE; i++) {
+      workspace[size+i] = 0xa55a;
+    }
+    for(unsigned i=0; i<SEARCH_COUNT; i++) {
+      const pathfinding_index_t start = lcg_rand(finder.nodes_size);
+      pathfinding_index_t goals[GOALS_SIZE];
+      uint32_t goals_costs[GOALS_SIZE];
+      uint32_t min_cost = UINT32_MAX;
+      for(uint8_t j=0; j<GOALS_SIZE; j++) {
+        goals[j] = lcg_rand(finder.nodes_size);
+        goals_costs[j] = dijkstra_cost(&finder, start, goals[j]);
+        if(goals_costs[j] < min_cost) {
+          min_cost = goals_costs[j];
+        }
+      }
+      pathfinding_start(&finder, workspace, start, goals[0]);
+      while(pathfinding_step(&finder, 3) == PATHFINDING_IN_PROGRESS) {
+      }
+      if(finder.path_cost != goals_costs[0]) {
+        errors++;
+      }
+      pathfinding_start_goals(&finder, workspace, start, goals, GOALS_SIZE);
+      while(pathfinding_step(&finder, 3) == PATHFINDING_IN_PROGRESS) {
+      }
+      if(finder.path_cost != min_cost) {
+        errors++;
+      }
+      uint32_t costs[GOALS_SIZE];
+      pathfinding_goals_costs(&finder, start, goals, GOALS_SIZE, costs);
+      if(memcmp(costs, goals_costs, sizeof(costs)) != 0) {
+        errors++;
+      }
+    }
+    for(size_t i=0; i<GUARD_SIZE; i++) {
+      if(workspace[size+i] != 0xa55a) {
+        printf("FAIL: %s: workspace of %zu bytes overflowed\n", random_graphs[k].name,
+               size * sizeof(*workspace));
+        return 1;
+      }
+    }
+    printf("  %-10s %5u nodes  %5zu bytes\n", random_graphs[k].name, finder.nodes_size,
+           size * sizeof(*workspace));
+  }
+  if(errors) {
+    printf("FAIL: %u search costs differ from Dijkstra\n", errors);
+    return 1;
+  }
+  return 0;
+}
+
+/// Check that smoothed paths are published with their arrival times
+static int test_smooth_reserve(void)
+{
+  static pathfinding_t finder;
+  finder_init(&finder, &random_graphs[ARRAY_SIZE(random_graphs)-1]);
+  finder.slot_length = 100;
+  pathfinding_obstacle_t obstacles[8];
+  for(uint8_t i=0; i<ARRAY_SIZE(obstacles); i++) {
+    random_obstacle(&obstacles[i]);
+  }
+  pathfinding_set_obstacles(&finder, obstacles, ARRAY_SIZE(obstacles));
+
+  pathfinding_reservation_t searched[PATHFINDING_MAX_PATH_SIZE];
+  pathfinding_reservation_t smoothed[PATHFINDING_MAX_PATH_SIZE];
+  unsigned removed = 0;
+  unsigned errors = 0;
+  for(unsigned i=0; i<SEARCH_COUNT; i++) {
+    pathfinding_search(&finder, lcg_rand(finder.nodes_size), lcg_rand(finder.nodes_size));
+    const uint8_t searched_size = pathfinding_reserve_path(&finder, searched, ARRAY_SIZE(searched));
+    pathfinding_smooth_path(&finder);
+    const uint8_t smoothed_size = pathfinding_reserve_path(&finder, smoothed, ARRAY_SIZE(smoothed));
+    removed += searched_size - smoothed_size;
+    // kept nodes are reserved from their arrival slot on the searched path
+    uint8_t k = 0;
+    for(uint8_t j=0; j<smoothed_size; j++) {
+      while(k < searched_size && searched[k].node != smoothed[j].node) {
+        k++;
+      }
+      if(k == searched_size || smoothed[j].begin != searched[k].begin ||
+         (j > 0 && smoothed[j-1].end != smoothed[j].begin)) {
+        errors++;
+        break;
+      }
+    }
+    if(smoothed_size && smoothed[smoothed_size-1].end != PATHFINDING_SLOT_FOREVER) {
+      errors++;
+    }
+  }
+  printf("smooth and reserve: %d searches, %u nodes removed by smoothing\n", SEARCH_COUNT, removed);
+  if(removed == 0) {
+    printf("FAIL: no path smoothed\n");
+    return 1;
+  }
+  if(errors) {
+    printf("FAIL: %u smoothed paths reserved with wrong arrival times\n", errors);
+    return 1;
+  }
+  return 0;
+}
+
+
+/// Test entry
+typedef struct {
+  const char *name;
+  int (*run)(void);
+} test_t;
+
+static const test_t tests[] = {
+  { "open_set", test_open_set },
+  { "costs", test_costs },
+  { "obstacles", test_obstacles },
+  { "shapes", test_shapes },
+  { "dstar", test_dstar },
+  { "positions", test_positions },
+  { "cache", test_cache },
+  { "workspace", test_workspace },
+  { "smooth_reserve", test_smooth_reserve },
+  { "benchmark", test_benchmark },
+};
+
+int main(int argc, char **argv)
+{
+  int ret = 0;
+  while(argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+    if(strcmp(argv[1], "--update-baseline") == 0) {
+      update_baseline = true;
+    } else if(strcmp(argv[1], "--benchmark") == 0) {
+      compare_times = true;
+    } else {
+      printf("unknown option: %s\n", argv[1]);
+      return 2;
+    }
+    argv++;
+    argc--;
+  }
+  for(unsigned i=0; i<ARRAY_SIZE(tests); i++) {
+    bool selected = argc <= 1;
+    for(int k=1; k<argc; k++) {
+      selected |= strcmp(argv[k], tests[i].name) == 0;
+    }
+    if(selected) {
+      ret |= tests[i].run();
+    }
+  }
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
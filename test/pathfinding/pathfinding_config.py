@@ -0,0 +1,29 @@
+import math
+
+set_max_path_size(64)
+set_stats(True)
+set_reservations(True)
+set_cache_size(4)
+set_max_workspace_size(2048)
+
+# random graphs, for open set benchmarks
+# landmarks are only used by incremental search checks
+# radius gives about 12 neighbors per node, for connected graphs whose
+# searches expand more than a few nodes; it is limited to keep path costs on
+# 16 bits, which only applies to the largest graph
+for n in (32, 64, 128, 250):
+  radius = min(int(math.sqrt(12 * 3000 * 2000 / math.pi / n)), 62000 // n)
+  add_random_graph('random%d' % n, (3000, 2000), n, radius, obstacles=4, seed=n,
+                   landmarks=4 if n == 250 else 0)
+
+# competition-like field, with walls and round obstacles
+add_field_graph('field', (3000, 2000), robot_radius=150,
+  polygons=[
+    [(1000, 0), (1022, 0), (1022, 600), (1000, 600)],
+    [(1978, 1400), (2000, 1400), (2000, 2000), (1978, 2000)],
+    [(1200, 950), (1800, 950), (1800, 972), (1200, 972)],
+  ],
+  circles=[(600, 1400, 100), (2400, 600, 100), (1500, 400, 80), (1500, 1600, 80)],
+  nodes={'start': (250, 1000), 'end': (2750, 1000)},
+  landmarks=4,
+)
@@ -0,0 +1,245 @@
+/** @file
+ * @brief Host test of timer callback profiling
+ *
+ * Compare matches are simulated by setting the counter of the emulated timer
+ * then calling the channel ISR. The callback advances the counter to simulate
+ * its execution time. Recorded distributions are printed and checked against
+ * the simulated latencies and execution times.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <timer/timer.h>
+
+void TCC0_CCA_vect(void);
+void TCC0_CCB_vect(void);
+
+/// Number of simulated compare matches
+#define MATCH_COUNT  1000
+
+/// Simulated execution time of the next callback, in ticks
+static uint16_t sim_duration;
+/// Number of callback executions
+static uint32_t callback_count;
+
+static void callback(void)
+{
+  callback_count++;
+  TCC0.CNT += sim_duration;
+}
+
+/// Pseudo-random generator, for reproducible runs
+static uint32_t lcg_state = 1;
+static uint16_t lcg_rand(uint16_t n)
+{
+  lcg_state = lcg_state * 1103515245 + 12345;
+  return (lcg_state >> 16) % n;
+}
+
+static void stat_expect_reset(timer_profile_stat_t *stat)
+{
+  memset(stat, 0, sizeof(*stat));
+  stat->min = 0xffff;
+}
+
+static void stat_expect_update(timer_profile_stat_t *stat, uint16_t value, uint8_t shift)
+{
+  if(value < stat->min) {
+    stat->min = value;
+  }
+  if(value > stat->max) {
+    stat->max = value;
+  }
+  uint16_t bin = value >> shift;
+  stat->histogram[bin < TIMER_PROFILING_BINS ? bin : TIMER_PROFILING_BINS-1]++;
+}
+
+static void stat_print(const char *name, const timer_profile_stat_t *stat, uint8_t shift)
+{
+  printf("  %s: min %u, max %u\n", name, stat->min, stat->max);
+  for(uint8_t i=0; i<TIMER_PROFILING_BINS; i++) {
+    const unsigned lo = i << shift;
+    printf("    %5u%s %6u ", lo, i == TIMER_PROFILING_BINS-1 ? "+ " : "  ", stat->histogram[i]);
+    for(uint16_t n=0; n<stat->histogram[i]; n+=10) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+}
+
+static int stat_check(const char *name, const timer_profile_stat_t *got, const timer_profile_stat_t *expected)
+{
+  if(memcmp(got, expected, sizeof(*got)) != 0) {
+    printf("FAIL: %s statistics differ from simulation\n", name);
+    return 1;
+  }
+  return 0;
+}
+
+
+/// Profile a periodic callback with random latencies and execution times
+static int test_periodic(void)
+{
+  const uint16_t period = 1000;
+  timer_profile_t expected;
+  expected.count = 0;
+  stat_expect_reset(&expected.latency);
+  stat_expect_reset(&expected.duration);
+
+  TCC0.CNT = 0;
+  callback_count = 0;
+  timer_set_callback(timerC0, TIMER_CHA, period, INTLVL_HI, callback);
+  for(uint16_t i=0; i<MATCH_COUNT; i++) {
+    // a few late interrupts, usually masked by higher priority code
+    const uint16_t latency = lcg_rand(10) == 0 ? 10 + lcg_rand(40) : lcg_rand(6);
+    const uint16_t duration = 20 + lcg_rand(100);
+    TCC0.CNT = TCC0.CCA + latency;
+    sim_duration = duration;
+    TCC0_CCA_vect();
+    expected.count++;
+    stat_expect_update(&expected.latency, latency, TIMER_PROFILING_LATENCY_SHIFT);
+    stat_expect_update(&expected.duration, duration, TIMER_PROFILING_DURATION_SHIFT);
+  }
+
+  timer_profile_t profile;
+  timer_get_profile(timerC0, TIMER_CHA, &profile);
+  printf("periodic callback: %lu executions\n", (unsigned long)profile.count);
+  stat_print("latency", &profile.latency, TIMER_PROFILING_LATENCY_SHIFT);
+  stat_print("duration", &profile.duration, TIMER_PROFILING_DURATION_SHIFT);
+
+  int ret = 0;
+  if(profile.count != MATCH_COUNT || callback_count != MATCH_COUNT) {
+    printf("FAIL: %lu recorded executions, %lu callbacks, expected %u\n",
+           (unsigned long)profile.count, (unsigned long)callback_count, MATCH_COUNT);
+    ret = 1;
+  }
+  ret |= stat_check("latency", &profile.latency, &expected.latency);
+  ret |= stat_check("duration", &profile.duration, &expected.duration);
+
+  // scheduling a callback resets profiling data
+  timer_set_callback(timerC0, TIMER_CHA, period, INTLVL_HI, callback);
+  timer_get_profile(timerC0, TIMER_CHA, &profile);
+  if(profile.count != 0 || profile.latency.min != 0xffff || profile.duration.max != 0) {
+    printf("FAIL: profiling data not reset\n");
+    ret = 1;
+  }
+  timer_clear_callback(timerC0, TIMER_CHA);
+  return ret;
+}
+
+/// Matches of intermediate epochs of long periods are not recorded
+static int test_long_period(void)
+{
+  TCC0.CNT = 0;
+  callback_count = 0;
+  sim_duration = 50;
+  // 2.5 epochs per period
+  timer_set_callback(timerC0, TIMER_CHB, 0x28000, INTLVL_HI, callback);
+  for(uint16_t i=0; i<3*3; i++) {
+    TCC0.CNT = TCC0.CCB + 3;
+    TCC0_CCB_vect();
+  }
+
+  timer_profile_t profile;
+  timer_get_profile(timerC0, TIMER_CHB, &profile);
+  timer_clear_callback(timerC0, TIMER_CHB);
+  printf("long period callback: %lu executions for 9 compare matches\n",
+         (unsigned long)profile.count);
+  if(profile.count != 3 || callback_count != 3) {
+    printf("FAIL: expected 3 executions\n");
+    return 1;
+  }
+  if(profile.latency.min != 3 || profile.latency.max != 3 ||
+     profile.duration.min != 50 || profile.duration.max != 50) {
+    printf("FAIL: unexpected latency or duration\n");
+    return 1;
+  }
+  return 0;
+}
+
+/// Simulated latency of compare interrupts, in ticks
+#define SIM_LATENCY  40
+
+/// Ticks elapsed since the start of a simulation
+static uint32_t sim_time;
+/// Value of sim_time at each callback match
+static uint32_t sim_matches[4];
+
+static void callback_record(void)
+{
+  if(callback_count < sizeof(sim_matches)/sizeof(*sim_matches)) {
+    sim_matches[callback_count] = sim_time - SIM_LATENCY;
+  }
+  callback_count++;
+}
+
+/** @brief Advance time to the next compare match of channel B, execute its ISR
+ *
+ * The ISR is executed SIM_LATENCY ticks after the match. A compare value the
+ * counter already passed is only matched after a whole counter wrap.
+ */
+static void sim_next_match(void)
+{
+  const uint16_t d = TCC0.CCB - TCC0.CNT;
+  const uint32_t ticks = (d ? d : 0x10000) + SIM_LATENCY;
+  TCC0.CNT += ticks;
+  sim_time += ticks;
+  TCC0_CCB_vect();
+}
+
+/// Long periods and delays with a tiny remainder are not delayed by a wrap
+static int test_long_delays(void)
+{
+  static const uint32_t periods[] = { 0x10001, 0x10002, 0x1ffff, 0x20001, 0x30005 };
+  int ret = 0;
+  for(uint8_t i=0; i<sizeof(periods)/sizeof(*periods); i++) {
+    const uint32_t period = periods[i];
+    TCC0.CNT = 0;
+    sim_time = 0;
+    callback_count = 0;
+    timer_set_callback(timerC0, TIMER_CHB, period, INTLVL_HI, callback_record);
+    while(sim_time < 3*period) {
+      sim_next_match();
+    }
+    timer_clear_callback(timerC0, TIMER_CHB);
+    printf("period 0x%lx: %lu executions\n", (unsigned long)period, (unsigned long)callback_count);
+    for(uint8_t k=0; k<3; k++) {
+      if(callback_count <= k || sim_matches[k] != (k+1) * period) {
+        printf("FAIL: execution %u not at %lu ticks\n", k, (unsigned long)(k+1) * period);
+        ret = 1;
+        break;
+      }
+    }
+  }
+
+  for(uint32_t k=0; k<=100; k = k < 8 ? k+1 : k*2) {
+    const uint32_t delay = 0x10000 + k;
+    TCC0.CNT = 0x1234;
+    sim_time = 0;
+    callback_count = 0;
+    timer_set_oneshot(timerC0, TIMER_CHB, delay, INTLVL_HI, callback_record);
+    while(callback_count == 0 && sim_time < 2*delay) {
+      sim_next_match();
+    }
+    if(callback_count != 1 || sim_matches[0] != delay) {
+      printf("FAIL: one-shot delay 0x%lx executed at %lu ticks\n",
+             (unsigned long)delay, (unsigned long)sim_matches[0]);
+      ret = 1;
+    } else if(TCC0.INTCTRLB & (3 << 2)) {
+      printf("FAIL: one-shot delay 0x%lx not disabled\n", (unsigned long)delay);
+      ret = 1;
+    }
+  }
+  printf("one-shot delays 0x10000+k: %s\n", ret ? "late" : "on time");
+  return ret;
+}
+
+
+int main(void)
+{
+  int ret = 0;
+  ret |= test_periodic();
+  ret |= test_long_period();
+  ret |= test_long_delays();
+  printf("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
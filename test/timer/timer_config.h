@@ -0,0 +1,18 @@
+/**
+ * @file
+ * @brief Timer configuration for host tests
+ */
+
+#define TIMER_PRESCALER_DIV  1
+
+#define TIMERC0_ENABLED
+#define TIMERC1_ENABLED
+
+#define UPTIME_TIMER  C1
+#define UPTIME_TIMER_CHANNEL  'A'
+#define UPTIME_TICK_US  1000
+
+#define TIMER_PROFILING  1
+#define TIMER_PROFILING_BINS  8
+#define TIMER_PROFILING_LATENCY_SHIFT  0
+#define TIMER_PROFILING_DURATION_SHIFT  4